@@ -0,0 +1,989 @@
+// Host benchmark and regression check for the signature scanner.
+//
+// Every case prints one JSON object per line. Each case also checks its
+// results: plain scans must resolve every pattern to a real match at or before
+// the offset it was sampled from, and the derive, detailed, fuzzy, file and
+// index cases must agree with a brute-force search of the same bytes. Masked
+// scans must stay within kMaxMaskedSlowdown of exact scans of the same
+// samples. Buffer batches also run through every scan engine on its own,
+// reported as engine/<engine>/... cases. With --baseline, cases slower than a previous run by more than --tolerance are
+// reported. The exit status is 1 when a check or a baseline comparison fails.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pl/memory/ModuleFile.h"
+#include "pl/memory/ModuleMap.h"
+#include "pl/memory/Signature.hpp"
+#include "pl/memory/SignatureScanner.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kPatternCounts[] = {1, 10, 100, 1000};
+constexpr size_t kPatternSize = 16;
+// Short enough that most samples match in several places.
+constexpr size_t kShortPatternSize = 4;
+constexpr size_t kCheckedPatterns = 10;
+// Masked signatures carry half the bits of exact ones but should not cost
+// much more to find.
+constexpr double kMaxMaskedSlowdown = 3;
+
+enum class AnchorKind { Exact, Masked };
+enum class CacheState { Cold, Warm };
+
+struct EngineName {
+  pl::memory::ScanEngine engine;
+  const char *name;
+};
+
+constexpr EngineName kScanEngines[] = {
+    {pl::memory::ScanEngine::Prefilter, "prefilter"},
+    {pl::memory::ScanEngine::Bucketed, "bucketed"},
+    {pl::memory::ScanEngine::Hashed, "hashed"},
+    {pl::memory::ScanEngine::ShiftAnd, "shift-and"},
+    {pl::memory::ScanEngine::Compact, "compact"},
+    {pl::memory::ScanEngine::Automaton, "automaton"},
+};
+
+struct Options {
+  size_t bufferBytes = 64u << 20;
+  double minSeconds = 0.2;
+  std::string module = "libc.so.6";
+  std::string filter;
+  std::string baseline;
+  double tolerance = 0.15;
+};
+
+// A signature sampled from memory and the address it was sampled at.
+struct Sample {
+  std::string signature;
+  uintptr_t address = 0;
+};
+
+struct CaseResult {
+  std::string name;
+  size_t patterns = 0;
+  size_t bytes = 0;
+  size_t iterations = 0;
+  double meanNs = 0;
+  double minNs = 0;
+  size_t found = 0;
+  bool verified = false;
+};
+
+// Exact signatures copy every byte; masked ones keep only high nibbles, so no
+// exact anchor exists and the scan falls back to masked anchors.
+std::string makeSignature(const uint8_t *data, AnchorKind kind,
+                          size_t size = kPatternSize) {
+  static constexpr char kDigits[] = "0123456789ABCDEF";
+  std::string signature;
+  for (size_t i = 0; i < size; ++i) {
+    if (i != 0) signature.push_back(' ');
+    signature.push_back(kDigits[data[i] >> 4]);
+    signature.push_back(kind == AnchorKind::Exact ? kDigits[data[i] & 0xF]
+                                                  : '?');
+  }
+  return signature;
+}
+
+std::vector<Sample> samplePatterns(uintptr_t start, uintptr_t end,
+                                   size_t count, AnchorKind kind,
+                                   std::mt19937_64 &rng,
+                                   size_t size = kPatternSize) {
+  std::uniform_int_distribution<uintptr_t> offset(start, end - size);
+  std::vector<Sample> samples(count);
+  for (auto &sample : samples) {
+    sample.address = offset(rng);
+    sample.signature = makeSignature(
+        reinterpret_cast<const uint8_t *>(sample.address), kind, size);
+  }
+  return samples;
+}
+
+struct ByteCollector {
+  std::vector<pl::memory::SignatureByte> bytes;
+
+  bool addByte(pl::memory::SignatureByte byte) {
+    bytes.push_back(byte);
+    return true;
+  }
+  bool addOp(pl::memory::SignatureOp) { return false; }
+};
+
+// The pattern bytes of a signature without address ops, or none when it has
+// some or does not parse.
+std::vector<pl::memory::SignatureByte>
+parseBytes(const std::string &signature) {
+  ByteCollector collector;
+  if (!pl::memory::parseSignature(signature, collector)) return {};
+  return std::move(collector.bytes);
+}
+
+// Pattern bytes that differ from the memory at address.
+size_t countMismatches(uintptr_t address,
+                       const std::vector<pl::memory::SignatureByte> &bytes,
+                       size_t limit = 0) {
+  const auto *data = reinterpret_cast<const uint8_t *>(address);
+  size_t mismatches = 0;
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    if ((data[i] & bytes[i].mask) != bytes[i].value &&
+        ++mismatches > limit) {
+      break;
+    }
+  }
+  return mismatches;
+}
+
+bool matchesAt(uintptr_t address, const std::string &signature) {
+  const auto bytes = parseBytes(signature);
+  return !bytes.empty() && countMismatches(address, bytes) == 0;
+}
+
+// The scanner reports the lowest match, which can precede the sample but never
+// follow it.
+bool verify(const std::vector<Sample> &samples,
+            const std::vector<uintptr_t> &addresses, size_t &found) {
+  found = 0;
+  bool valid = addresses.size() == samples.size();
+  for (size_t i = 0; valid && i < samples.size(); ++i) {
+    if (addresses[i] == 0) {
+      valid = false;
+      break;
+    }
+    ++found;
+    valid = addresses[i] <= samples[i].address &&
+            matchesAt(addresses[i], samples[i].signature);
+  }
+  return valid;
+}
+
+std::vector<std::string> signaturesOf(const std::vector<Sample> &samples) {
+  std::vector<std::string> signatures;
+  signatures.reserve(samples.size());
+  for (const auto &sample : samples) signatures.push_back(sample.signature);
+  return signatures;
+}
+
+const char *toString(AnchorKind kind) {
+  return kind == AnchorKind::Exact ? "exact" : "masked";
+}
+
+const char *toString(CacheState cache) {
+  return cache == CacheState::Cold ? "cold" : "warm";
+}
+
+// Runs scan until minSeconds have been spent inside it, calling prepare
+// untimed before every iteration, then has check count and verify the results
+// of the last one.
+template <typename Prepare, typename Scan, typename Check>
+CaseResult measure(const Options &options, Prepare &&prepare, Scan &&scan,
+                   Check &&check) {
+  CaseResult result;
+  decltype(scan()) results;
+  double totalNs = 0;
+  while (result.iterations == 0 || totalNs < options.minSeconds * 1e9) {
+    prepare();
+    const auto begin = Clock::now();
+    results = scan();
+    const double elapsed =
+        std::chrono::duration<double, std::nano>(Clock::now() - begin)
+            .count();
+    totalNs += elapsed;
+    result.minNs = result.iterations == 0 ? elapsed
+                                          : std::min(result.minNs, elapsed);
+    ++result.iterations;
+  }
+  result.meanNs = totalNs / static_cast<double>(result.iterations);
+  result.verified = check(results, result.found);
+  return result;
+}
+
+// Cold runs drop every cache before each iteration; warm runs are primed by
+// one untimed call.
+template <typename Scan> auto prepareCaches(CacheState cache, Scan &scan) {
+  return [cache, &scan, primed = false]() mutable {
+    if (cache == CacheState::Warm && primed) return;
+    pl::memory::clearSignatureCaches();
+    if (cache == CacheState::Warm) scan();
+    primed = true;
+  };
+}
+
+void printResult(const CaseResult &result) {
+  const double throughput =
+      result.minNs > 0
+          ? static_cast<double>(result.bytes) / result.minNs * 1e3
+          : 0;
+  std::printf("{\"name\":\"%s\",\"patterns\":%zu,\"bytes\":%zu,"
+              "\"iterations\":%zu,\"mean_ns\":%.0f,\"min_ns\":%.0f,"
+              "\"mb_per_s\":%.1f,\"found\":%zu,\"verified\":%s}\n",
+              result.name.c_str(), result.patterns, result.bytes,
+              result.iterations, result.meanNs, result.minNs, throughput,
+              result.found, result.verified ? "true" : "false");
+  std::fflush(stdout);
+}
+
+std::string findField(std::string_view line, std::string_view key) {
+  std::string quoted = "\"";
+  quoted.append(key);
+  quoted.append("\":");
+  const size_t start = line.find(quoted);
+  if (start == std::string_view::npos) return {};
+  size_t pos = start + quoted.size();
+  if (pos < line.size() && line[pos] == '"') {
+    const size_t end = line.find('"', pos + 1);
+    return std::string(line.substr(pos + 1, end - pos - 1));
+  }
+  const size_t end = line.find_first_of(",}", pos);
+  return std::string(line.substr(pos, end - pos));
+}
+
+std::unordered_map<std::string, double>
+readBaseline(const std::string &path) {
+  std::unordered_map<std::string, double> baseline;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    const std::string name = findField(line, "name");
+    const std::string minNs = findField(line, "min_ns");
+    if (!name.empty() && !minNs.empty()) {
+      baseline[name] = std::strtod(minNs.c_str(), nullptr);
+    }
+  }
+  return baseline;
+}
+
+class Runner {
+public:
+  explicit Runner(Options options)
+      : mOptions(std::move(options)),
+        mBaseline(readBaseline(mOptions.baseline)) {}
+
+  [[nodiscard]] bool wants(const std::string &name) const {
+    return mOptions.filter.empty() ||
+           name.find(mOptions.filter) != std::string::npos;
+  }
+
+  template <typename Scan>
+  void run(std::string name, size_t bytes, CacheState cache,
+           const std::vector<Sample> &samples, Scan &&scan) {
+    run(std::move(name), bytes, samples.size(), prepareCaches(cache, scan),
+        scan, [&](const std::vector<uintptr_t> &addresses, size_t &found) {
+          return verify(samples, addresses, found);
+        });
+  }
+
+  template <typename Prepare, typename Scan, typename Check>
+  void run(std::string name, size_t bytes, size_t patterns, Prepare &&prepare,
+           Scan &&scan, Check &&check) {
+    if (!wants(name)) return;
+
+    CaseResult result = measure(mOptions, prepare, scan, check);
+    result.name = std::move(name);
+    result.patterns = patterns;
+    result.bytes = bytes;
+    printResult(result);
+    mMinNs[result.name] = result.minNs;
+    if (!result.verified) {
+      std::fprintf(stderr, "%s: wrong results (%zu/%zu found)\n",
+                   result.name.c_str(), result.found, result.patterns);
+      mFailed = true;
+    }
+
+    const auto it = mBaseline.find(result.name);
+    if (it != mBaseline.end() &&
+        result.minNs > it->second * (1 + mOptions.tolerance)) {
+      std::fprintf(stderr, "%s: %.0f ns, baseline %.0f ns\n",
+                   result.name.c_str(), result.minNs, it->second);
+      mFailed = true;
+    }
+  }
+
+  // Fails the run when slower took more than factor times as long as faster.
+  // Cases the filter skipped are not compared.
+  void expectWithin(const std::string &slower, const std::string &faster,
+                    double factor) {
+    const auto slowerIt = mMinNs.find(slower);
+    const auto fasterIt = mMinNs.find(faster);
+    if (slowerIt == mMinNs.end() || fasterIt == mMinNs.end()) return;
+    if (slowerIt->second > fasterIt->second * factor) {
+      std::fprintf(stderr, "%s: %.0f ns, more than %.1fx %s (%.0f ns)\n",
+                   slower.c_str(), slowerIt->second, factor, faster.c_str(),
+                   fasterIt->second);
+      mFailed = true;
+    }
+  }
+
+  [[nodiscard]] const Options &options() const noexcept { return mOptions; }
+  [[nodiscard]] bool failed() const noexcept { return mFailed; }
+
+private:
+  Options mOptions;
+  std::unordered_map<std::string, double> mBaseline;
+  std::unordered_map<std::string, double> mMinNs;
+  bool mFailed = false;
+};
+
+std::string caseName(std::string_view group, AnchorKind kind, size_t count,
+                     CacheState cache) {
+  std::string name(group);
+  name.append("/").append(toString(kind));
+  name.append("/").append(std::to_string(count));
+  name.append("/").append(toString(cache));
+  return name;
+}
+
+// Masked cases sample the addresses their exact twins did, so only the
+// anchors differ between the two.
+void expectMaskedWithinExact(Runner &runner, std::string_view group) {
+  for (const size_t count : kPatternCounts) {
+    runner.expectWithin(
+        caseName(group, AnchorKind::Masked, count, CacheState::Cold),
+        caseName(group, AnchorKind::Exact, count, CacheState::Cold),
+        kMaxMaskedSlowdown);
+  }
+}
+
+// The same batch on each engine alone. Engines that cannot hold the batch are
+// skipped with a note rather than failed.
+void runEngineCases(Runner &runner, const std::vector<uint8_t> &buffer,
+                    AnchorKind kind, const std::vector<Sample> &samples,
+                    const std::vector<std::string> &signatures) {
+  for (const auto &[engine, engineName] : kScanEngines) {
+    const auto name = caseName(std::string("engine/") + engineName, kind,
+                               samples.size(), CacheState::Cold);
+    if (!runner.wants(name)) continue;
+    if (!pl::memory::scanSignatureBuffer(signatures, {}, engine)) {
+      std::fprintf(stderr, "%s: engine cannot hold this batch\n",
+                   name.c_str());
+      continue;
+    }
+    runner.run(name, buffer.size(), CacheState::Cold, samples, [&] {
+      return *pl::memory::scanSignatureBuffer(signatures, buffer, engine);
+    });
+  }
+}
+
+// scanSignatureBuffer keeps nothing between calls, so buffers have no warm
+// state.
+void runBufferCases(Runner &runner, std::mt19937_64 &rng) {
+  std::vector<uint8_t> buffer(runner.options().bufferBytes);
+  for (auto &byte : buffer) byte = static_cast<uint8_t>(rng());
+  const auto start = reinterpret_cast<uintptr_t>(buffer.data());
+
+  const auto seed = rng();
+  for (const AnchorKind kind : {AnchorKind::Exact, AnchorKind::Masked}) {
+    std::mt19937_64 sampleRng(seed);
+    for (const size_t count : kPatternCounts) {
+      const auto samples = samplePatterns(start, start + buffer.size(), count,
+                                          kind, sampleRng);
+      const auto signatures = signaturesOf(samples);
+      runner.run(caseName("buffer", kind, count, CacheState::Cold),
+                 buffer.size(), CacheState::Cold, samples, [&] {
+                   return pl::memory::scanSignatureBuffer(signatures, buffer);
+                 });
+      runEngineCases(runner, buffer, kind, samples, signatures);
+    }
+  }
+  expectMaskedWithinExact(runner, "buffer");
+}
+
+struct Range {
+  uintptr_t start = 0;
+  uintptr_t end = 0;
+};
+
+// The library the module cases scan.
+struct BenchModule {
+  std::shared_ptr<const pl::memory::ModuleMap> map;
+  const pl::memory::LoadedModule *image = nullptr;
+  const pl::memory::ModuleSegment *text = nullptr;
+  std::vector<Range> code;
+  size_t codeBytes = 0;
+};
+
+// Executable segments of image. Merging joins touching ones the way resolves
+// build their regions; the suffix index keeps them apart.
+std::vector<Range> getCodeRanges(const pl::memory::LoadedModule &image,
+                                 bool merge) {
+  std::vector<Range> ranges;
+  for (const auto &segment : image.segments) {
+    if (!segment.executable) continue;
+    if (merge && !ranges.empty() && ranges.back().end >= segment.start) {
+      ranges.back().end = std::max(ranges.back().end, segment.end);
+    } else {
+      ranges.push_back(Range{segment.start, segment.end});
+    }
+  }
+  return ranges;
+}
+
+// Every aligned place in ranges that bytes match, lowest first, up to limit.
+std::vector<uintptr_t>
+findMatches(const std::vector<Range> &ranges,
+            const std::vector<pl::memory::SignatureByte> &bytes,
+            size_t alignment = 1, size_t limit = SIZE_MAX) {
+  std::vector<uintptr_t> matches;
+  if (bytes.empty()) return matches;
+  for (const auto &range : ranges) {
+    if (range.end - range.start < bytes.size()) continue;
+    const uintptr_t last = range.end - bytes.size();
+    for (uintptr_t address = (range.start + alignment - 1) & ~(alignment - 1);
+         address <= last; address += alignment) {
+      if (countMismatches(address, bytes) != 0) continue;
+      matches.push_back(address);
+      if (matches.size() == limit) return matches;
+    }
+  }
+  return matches;
+}
+
+uintptr_t findFirstMatch(const std::vector<Range> &ranges,
+                         const std::string &signature) {
+  const auto matches = findMatches(ranges, parseBytes(signature), 1, 1);
+  return matches.empty() ? 0 : matches.front();
+}
+
+// The lowest of the closest places within maxMismatches of bytes, or address
+// 0 when there is none.
+pl::memory::SignatureFuzzyMatch
+findClosestMatch(const std::vector<Range> &ranges,
+                 const std::vector<pl::memory::SignatureByte> &bytes,
+                 size_t maxMismatches) {
+  pl::memory::SignatureFuzzyMatch best;
+  size_t limit = maxMismatches;
+  for (const auto &range : ranges) {
+    if (range.end - range.start < bytes.size()) continue;
+    const uintptr_t last = range.end - bytes.size();
+    for (uintptr_t address = range.start; address <= last; ++address) {
+      const size_t distance = countMismatches(address, bytes, limit);
+      if (distance > limit) continue;
+      best.address = address;
+      best.distance = distance;
+      if (distance == 0) break;
+      limit = distance - 1;
+    }
+    if (best.address != 0 && best.distance == 0) break;
+  }
+  if (best.address == 0) return best;
+  const auto *data = reinterpret_cast<const uint8_t *>(best.address);
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    if ((data[i] & bytes[i].mask) != bytes[i].value) {
+      best.mismatches.push_back(i);
+    }
+  }
+  return best;
+}
+
+// Results must equal the brute-force addresses.
+auto expectAddresses(const std::vector<uintptr_t> &expected) {
+  return [&expected](const std::vector<uintptr_t> &addresses, size_t &found) {
+    found = static_cast<size_t>(std::ranges::count_if(
+        addresses, [](uintptr_t address) { return address != 0; }));
+    return addresses == expected;
+  };
+}
+
+// resolveSignatures, with the addresses in the order of signatures.
+std::vector<uintptr_t>
+resolveInOrder(const std::vector<std::string> &signatures,
+               const std::string &moduleName,
+               const pl::memory::SignatureScanOptions &options) {
+  const auto results =
+      pl::memory::resolveSignatures(signatures, moduleName, options);
+  std::vector<uintptr_t> addresses;
+  addresses.reserve(signatures.size());
+  for (const auto &signature : signatures) {
+    addresses.push_back(results.at(signature));
+  }
+  return addresses;
+}
+
+bool loadBenchModule(const std::string &moduleName, BenchModule &module) {
+  void *handle = dlopen(moduleName.c_str(), RTLD_NOW);
+  module.map = pl::memory::getModuleMap();
+  module.image = module.map->findModule(moduleName);
+  if (!module.image) {
+    std::fprintf(stderr, "module %s is not loaded: %s\n", moduleName.c_str(),
+                 handle ? "not in module map" : dlerror());
+    return false;
+  }
+
+  for (const auto &segment : module.image->segments) {
+    if (!segment.executable) continue;
+    module.codeBytes += segment.end - segment.start;
+    if (!module.text ||
+        segment.end - segment.start > module.text->end - module.text->start) {
+      module.text = &segment;
+    }
+  }
+  if (!module.text) {
+    std::fprintf(stderr, "module %s has no code\n", moduleName.c_str());
+    return false;
+  }
+  module.code = getCodeRanges(*module.image, true);
+  return true;
+}
+
+pl::memory::SignatureScanOptions codeScope() {
+  pl::memory::SignatureScanOptions options;
+  options.scope = pl::memory::SignatureScope::Executable;
+  return options;
+}
+
+// Scans the executable segments of a real shared library through the public
+// API, so module lookup and the address caches are part of the measurement.
+void runModuleCases(Runner &runner, const BenchModule &module,
+                    std::mt19937_64 &rng) {
+  const auto &moduleName = runner.options().module;
+  const auto scanOptions = codeScope();
+  const auto seed = rng();
+  for (const AnchorKind kind : {AnchorKind::Exact, AnchorKind::Masked}) {
+    std::mt19937_64 sampleRng(seed);
+    for (const size_t count : kPatternCounts) {
+      const auto samples = samplePatterns(
+          module.text->start, module.text->end, count, kind, sampleRng);
+      const auto signatures = signaturesOf(samples);
+      for (const CacheState cache : {CacheState::Cold, CacheState::Warm}) {
+        runner.run(caseName("module", kind, count, cache), module.codeBytes,
+                   cache, samples, [&] {
+                     return resolveInOrder(signatures, moduleName,
+                                           scanOptions);
+                   });
+      }
+    }
+  }
+  expectMaskedWithinExact(runner, "module");
+}
+
+// Offset and load ops on exact patterns. Branch and PC-relative ops decode
+// ARM code, which a host library does not have.
+void runDeriveCases(Runner &runner, const BenchModule &module,
+                    std::mt19937_64 &rng) {
+  struct DeriveCase {
+    const char *name;
+    const char *ops;
+    bool load;
+  };
+  constexpr uintptr_t kOffset = 8;
+  constexpr DeriveCase kCases[] = {{"offset", " | +8", false},
+                                   {"load", " | +8 *", true}};
+
+  const auto &moduleName = runner.options().module;
+  const auto scanOptions = codeScope();
+  const auto samples =
+      samplePatterns(module.text->start, module.text->end, kCheckedPatterns,
+                     AnchorKind::Exact, rng);
+  for (const auto &derive : kCases) {
+    std::vector<std::string> signatures;
+    std::vector<uintptr_t> expected;
+    for (const auto &sample : samples) {
+      signatures.push_back(sample.signature + derive.ops);
+      const uintptr_t match = findFirstMatch(module.code, sample.signature);
+      uintptr_t target = match + kOffset;
+      if (derive.load) {
+        std::memcpy(&target, reinterpret_cast<const void *>(target),
+                    sizeof(target));
+      }
+      expected.push_back(match != 0 ? target : 0);
+    }
+    const auto scan = [&] {
+      return resolveInOrder(signatures, moduleName, scanOptions);
+    };
+    for (const CacheState cache : {CacheState::Cold, CacheState::Warm}) {
+      runner.run("derive/" + std::string(derive.name) + "/" +
+                     std::to_string(signatures.size()) + "/" +
+                     toString(cache),
+                 module.codeBytes, signatures.size(),
+                 prepareCaches(cache, scan), scan, expectAddresses(expected));
+    }
+  }
+}
+
+// Short patterns, so most of them have several matches to count. Detailed
+// resolves bypass the caches, so only cold runs are measured.
+void runDetailedCases(Runner &runner, const BenchModule &module,
+                      std::mt19937_64 &rng) {
+  const auto &moduleName = runner.options().module;
+  pl::memory::SignatureDetailOptions options;
+  options.scan = codeScope();
+  const auto signatures = signaturesOf(
+      samplePatterns(module.text->start, module.text->end, kCheckedPatterns,
+                     AnchorKind::Exact, rng, kShortPatternSize));
+
+  std::vector<pl::memory::SignatureMatchInfo> expected;
+  for (const auto &signature : signatures) {
+    const auto matches = findMatches(module.code, parseBytes(signature), 1,
+                                     options.maxMatchCount);
+    auto &info = expected.emplace_back();
+    info.address = matches.empty() ? 0 : matches.front();
+    info.matchCount = matches.size();
+    info.addresses.assign(
+        matches.begin(),
+        matches.begin() + static_cast<ptrdiff_t>(
+                              std::min(matches.size(), options.maxAddresses)));
+    info.unique = matches.size() == 1;
+  }
+
+  runner.run(
+      "detailed/exact/" + std::to_string(signatures.size()) + "/cold",
+      module.codeBytes, signatures.size(), pl::memory::clearSignatureCaches,
+      [&] {
+        return pl::memory::resolveSignaturesDetailed(signatures, moduleName,
+                                                     options);
+      },
+      [&](const std::unordered_map<std::string,
+                                   pl::memory::SignatureMatchInfo> &results,
+          size_t &found) {
+        found = 0;
+        bool valid = true;
+        for (size_t i = 0; i < signatures.size(); ++i) {
+          const auto it = results.find(signatures[i]);
+          if (it == results.end()) return false;
+          const auto &info = it->second;
+          if (info.address != 0) ++found;
+          valid = valid && info.address == expected[i].address &&
+                  info.matchCount == expected[i].matchCount &&
+                  info.addresses == expected[i].addresses &&
+                  info.unique == expected[i].unique;
+        }
+        return valid;
+      });
+}
+
+// Samples with maxMismatches bytes changed, so the closest match is rarely an
+// exact one. Fuzzy resolves bypass the caches, so only cold runs are measured.
+void runFuzzyCases(Runner &runner, const BenchModule &module,
+                   std::mt19937_64 &rng) {
+  const auto &moduleName = runner.options().module;
+  pl::memory::SignatureFuzzyOptions options;
+  options.scan = codeScope();
+
+  std::uniform_int_distribution<size_t> position(0, kPatternSize - 1);
+  std::uniform_int_distribution<int> flip(1, 0xFF);
+  std::vector<std::string> signatures;
+  std::vector<pl::memory::SignatureFuzzyMatch> expected;
+  for (const auto &sample :
+       samplePatterns(module.text->start, module.text->end, kCheckedPatterns,
+                      AnchorKind::Exact, rng)) {
+    uint8_t data[kPatternSize];
+    std::memcpy(data, reinterpret_cast<const void *>(sample.address),
+                sizeof(data));
+    for (size_t i = 0; i < options.maxMismatches; ++i) {
+      data[position(rng)] ^= static_cast<uint8_t>(flip(rng));
+    }
+    signatures.push_back(makeSignature(data, AnchorKind::Exact));
+    expected.push_back(findClosestMatch(
+        module.code, parseBytes(signatures.back()), options.maxMismatches));
+  }
+
+  runner.run(
+      "fuzzy/exact/" + std::to_string(signatures.size()) + "/cold",
+      module.codeBytes, signatures.size(), pl::memory::clearSignatureCaches,
+      [&] {
+        return pl::memory::resolveSignaturesFuzzy(signatures, moduleName,
+                                                  options);
+      },
+      [&](const std::unordered_map<std::string,
+                                   pl::memory::SignatureFuzzyMatch> &results,
+          size_t &found) {
+        found = 0;
+        bool valid = true;
+        for (size_t i = 0; i < signatures.size(); ++i) {
+          const auto it = results.find(signatures[i]);
+          if (it == results.end()) return false;
+          const auto &match = it->second;
+          if (match.address != 0) ++found;
+          valid = valid && match.address == expected[i].address &&
+                  (match.address == 0 ||
+                   (match.distance == expected[i].distance &&
+                    match.mismatches == expected[i].mismatches));
+        }
+        return valid;
+      });
+}
+
+// Resolves in the module file, which is mapped and scanned again on every
+// call, so only cold runs are measured.
+bool runFileCases(Runner &runner, const BenchModule &module,
+                  std::mt19937_64 &rng) {
+  const auto &path = module.image->path;
+  const pl::memory::MappedModuleFile file(path);
+  if (!file.valid()) {
+    std::fprintf(stderr, "cannot map %s\n", path.c_str());
+    return false;
+  }
+  const auto fileCode = getCodeRanges(file.image(), true);
+  const auto scanOptions = codeScope();
+
+  for (const size_t count : {kCheckedPatterns, size_t{100}}) {
+    const auto signatures = signaturesOf(
+        samplePatterns(module.text->start, module.text->end, count,
+                       AnchorKind::Exact, rng));
+    std::vector<uintptr_t> expected;
+    for (const auto &signature : signatures) {
+      const uintptr_t match = findFirstMatch(fileCode, signature);
+      expected.push_back(match != 0 ? match - file.image().base : 0);
+    }
+    runner.run(
+        "file/exact/" + std::to_string(count) + "/cold", module.codeBytes,
+        count, pl::memory::clearSignatureCaches,
+        [&] {
+          const auto results = pl::memory::resolveSignaturesInFile(
+              signatures, path, scanOptions);
+          std::vector<uintptr_t> offsets;
+          offsets.reserve(signatures.size());
+          for (const auto &signature : signatures) {
+            offsets.push_back(results.at(signature));
+          }
+          return offsets;
+        },
+        expectAddresses(expected));
+  }
+  return true;
+}
+
+// The shortest exact prefix of the file bytes at address that matches no
+// other aligned place in ranges, which is what generateSignature returns when
+// it masks nothing.
+std::string findShortestUnique(const std::vector<Range> &ranges,
+                               uintptr_t address, size_t maxLength,
+                               size_t alignment) {
+  const auto range = std::ranges::find_if(ranges, [&](const Range &range) {
+    return address >= range.start && address < range.end;
+  });
+  if (range == ranges.end() || (address & (alignment - 1)) != 0) return {};
+
+  const auto *data = reinterpret_cast<const uint8_t *>(address);
+  const auto isUnique = [&](size_t size) {
+    std::vector<pl::memory::SignatureByte> bytes(size);
+    for (size_t i = 0; i < size; ++i) bytes[i] = {data[i], 0xFF};
+    return findMatches(ranges, bytes, alignment, 2).size() == 1;
+  };
+  size_t high = std::min(maxLength, range->end - address);
+  if (!isUnique(high)) return {};
+  size_t low = 1;
+  while (low < high) {
+    const size_t middle = low + (high - low) / 2;
+    if (isUnique(middle)) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  return makeSignature(data, AnchorKind::Exact, low);
+}
+
+// countSignatureMatches and generateSignature answer from a suffix index of
+// the module file. Cold runs include building it.
+bool runSuffixIndexCases(Runner &runner, const BenchModule &module,
+                         std::mt19937_64 &rng) {
+  const auto &moduleName = runner.options().module;
+  const pl::memory::MappedModuleFile file(module.image->path);
+  if (!file.valid()) {
+    std::fprintf(stderr, "cannot map %s\n", module.image->path.c_str());
+    return false;
+  }
+  const auto fileCode = getCodeRanges(file.image(), false);
+  const size_t alignment = pl::memory::kCodeAlignment;
+
+  const auto counted = signaturesOf(
+      samplePatterns(module.text->start, module.text->end, kCheckedPatterns,
+                     AnchorKind::Exact, rng, kShortPatternSize));
+  std::vector<size_t> expectedCounts;
+  for (const auto &signature : counted) {
+    expectedCounts.push_back(
+        findMatches(fileCode, parseBytes(signature), alignment).size());
+  }
+  const auto count = [&] {
+    std::vector<size_t> counts;
+    counts.reserve(counted.size());
+    for (const auto &signature : counted) {
+      counts.push_back(
+          pl::memory::countSignatureMatches(signature, moduleName, alignment));
+    }
+    return counts;
+  };
+  for (const CacheState cache : {CacheState::Cold, CacheState::Warm}) {
+    runner.run("index/suffix/count/" + std::to_string(counted.size()) + "/" +
+                   toString(cache),
+               module.codeBytes, counted.size(), prepareCaches(cache, count),
+               count, [&](const std::vector<size_t> &counts, size_t &found) {
+                 found = static_cast<size_t>(std::ranges::count_if(
+                     counts, [](size_t matches) { return matches != 0; }));
+                 return counts == expectedCounts;
+               });
+  }
+
+  // Exact bytes keep the expected signature a plain prefix of the code. The
+  // loaded text is padded to a page past the last byte the file has, and
+  // generateSignature only signs bytes the file has.
+  pl::memory::SignatureGenerateOptions options;
+  options.alignment = alignment;
+  options.wildcardRelocations = false;
+  const uintptr_t fileBias = file.image().base - module.image->base;
+  uintptr_t textEnd = module.text->end;
+  for (const auto &range : fileCode) {
+    if (module.text->start + fileBias >= range.start &&
+        module.text->start + fileBias < range.end) {
+      textEnd = std::min(textEnd, range.end - fileBias);
+    }
+  }
+  std::vector<uintptr_t> addresses;
+  std::vector<std::string> expected;
+  for (const auto &sample :
+       samplePatterns(module.text->start, textEnd, kCheckedPatterns,
+                      AnchorKind::Exact, rng)) {
+    const uintptr_t address = sample.address & ~(alignment - 1);
+    addresses.push_back(address);
+    expected.push_back(findShortestUnique(fileCode, address + fileBias,
+                                          options.maxLength, alignment));
+  }
+  const auto generate = [&] {
+    std::vector<std::string> signatures;
+    signatures.reserve(addresses.size());
+    for (const uintptr_t address : addresses) {
+      signatures.push_back(
+          pl::memory::generateSignature(address, moduleName, options));
+    }
+    return signatures;
+  };
+  for (const CacheState cache : {CacheState::Cold, CacheState::Warm}) {
+    runner.run(
+        "index/suffix/generate/" + std::to_string(addresses.size()) + "/" +
+            toString(cache),
+        module.codeBytes, addresses.size(), prepareCaches(cache, generate),
+        generate,
+        [&](const std::vector<std::string> &signatures, size_t &found) {
+          found = static_cast<size_t>(std::ranges::count_if(
+              signatures,
+              [](const std::string &signature) { return !signature.empty(); }));
+          return signatures == expected;
+        });
+  }
+  return true;
+}
+
+// Once enabled the gram index serves every later resolve in the module, so
+// these cases run last. Every iteration starts from empty caches and a
+// rebuilt index, which times the index lookups rather than the build.
+void runGramIndexCases(Runner &runner, const BenchModule &module,
+                       std::mt19937_64 &rng) {
+  constexpr int kIndexWaitMs = 10'000;
+  const auto &moduleName = runner.options().module;
+  const auto scanOptions = codeScope();
+  pl::memory::enableSignatureIndex(moduleName);
+
+  for (const size_t count : {kCheckedPatterns, size_t{100}}) {
+    const auto signatures = signaturesOf(
+        samplePatterns(module.text->start, module.text->end, count,
+                       AnchorKind::Exact, rng));
+    std::vector<uintptr_t> expected;
+    for (const auto &signature : signatures) {
+      expected.push_back(findFirstMatch(module.code, signature));
+    }
+
+    // The first resolve after a clear starts the rebuild; probes that no
+    // cache knows keep resolving until one is looked up in the index.
+    pl::memory::SignatureStats before;
+    const auto prepare = [&] {
+      pl::memory::clearSignatureCaches();
+      const uint64_t cleared = pl::memory::getSignatureStats().indexedPatterns;
+      for (int waited = 0; waited < kIndexWaitMs; ++waited) {
+        resolveInOrder(signaturesOf(samplePatterns(
+                           module.text->start, module.text->end, 1,
+                           AnchorKind::Exact, rng)),
+                       moduleName, scanOptions);
+        if (pl::memory::getSignatureStats().indexedPatterns != cleared) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      before = pl::memory::getSignatureStats();
+    };
+    const auto check = expectAddresses(expected);
+    runner.run(
+        "index/gram/exact/" + std::to_string(count) + "/cold",
+        module.codeBytes, count, prepare,
+        [&] { return resolveInOrder(signatures, moduleName, scanOptions); },
+        [&](const std::vector<uintptr_t> &addresses, size_t &found) {
+          // Hints left by the file cases may answer a few patterns first,
+          // but none may fall through to a full scan.
+          const auto after = pl::memory::getSignatureStats();
+          return check(addresses, found) &&
+                 after.indexedPatterns > before.indexedPatterns &&
+                 after.scannedPatterns == before.scannedPatterns;
+        });
+  }
+}
+
+void printUsage(const char *program) {
+  std::fprintf(stderr,
+               "usage: %s [--buffer-mib N] [--min-time SECONDS] "
+               "[--module NAME] [--filter TEXT] [--baseline FILE] "
+               "[--tolerance FRACTION]\n",
+               program);
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (i + 1 >= argc) return false;
+    const char *value = argv[++i];
+    if (arg == "--buffer-mib") {
+      options.bufferBytes = std::strtoull(value, nullptr, 10) << 20;
+    } else if (arg == "--min-time") {
+      options.minSeconds = std::strtod(value, nullptr);
+    } else if (arg == "--module") {
+      options.module = value;
+    } else if (arg == "--filter") {
+      options.filter = value;
+    } else if (arg == "--baseline") {
+      options.baseline = value;
+    } else if (arg == "--tolerance") {
+      options.tolerance = std::strtod(value, nullptr);
+    } else {
+      return false;
+    }
+  }
+  return options.bufferBytes >= kPatternSize;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  Runner runner(std::move(options));
+  std::mt19937_64 rng(0x5167);
+  runBufferCases(runner, rng);
+  BenchModule module;
+  bool moduleScanned = loadBenchModule(runner.options().module, module);
+  if (moduleScanned) {
+    runModuleCases(runner, module, rng);
+    runDeriveCases(runner, module, rng);
+    runDetailedCases(runner, module, rng);
+    runFuzzyCases(runner, module, rng);
+    moduleScanned = runFileCases(runner, module, rng) &&
+                    runSuffixIndexCases(runner, module, rng);
+    runGramIndexCases(runner, module, rng);
+  }
+  return runner.failed() || !moduleScanned ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+#include "pl/Gloss.h"
+
+#include <fstream>
+#include <link.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pl/memory/ModuleMap.h"
+
+namespace {
+
+template <typename T>
+bool readAt(std::ifstream &file, std::streamoff offset, T *out, size_t count) {
+  file.seekg(offset);
+  file.read(reinterpret_cast<char *>(out),
+            static_cast<std::streamsize>(sizeof(T) * count));
+  return static_cast<bool>(file);
+}
+
+} // namespace
+
+extern "C" {
+
+void GlossInit(bool) {}
+
+// Reads the section headers of the loaded image from disk.
+uintptr_t GlossGetLibSection(const char *lib_name, const char *sec_name,
+                             size_t *sec_size) {
+  const auto map = pl::memory::getModuleMap();
+  const auto *module = map->findModule(lib_name);
+  if (!module) return 0;
+
+  std::ifstream file(module->path, std::ios::binary);
+  ElfW(Ehdr) header{};
+  if (!readAt(file, 0, &header, 1) || header.e_shstrndx >= header.e_shnum) {
+    return 0;
+  }
+
+  std::vector<ElfW(Shdr)> sections(header.e_shnum);
+  if (!readAt(file, static_cast<std::streamoff>(header.e_shoff),
+              sections.data(), sections.size())) {
+    return 0;
+  }
+
+  const auto &names = sections[header.e_shstrndx];
+  std::string strings(names.sh_size, '\0');
+  if (!readAt(file, static_cast<std::streamoff>(names.sh_offset),
+              strings.data(), strings.size())) {
+    return 0;
+  }
+
+  for (const auto &section : sections) {
+    if (section.sh_name >= strings.size() ||
+        std::string_view(strings.c_str() + section.sh_name) != sec_name) {
+      continue;
+    }
+    if (sec_size) *sec_size = section.sh_size;
+    return module->base + section.sh_addr;
+  }
+  return 0;
+}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// Host stand-in for the NDK logger: warnings and errors go to stderr.
+
+#include <cstdarg>
+#include <cstdio>
+
+enum android_LogPriority {
+  ANDROID_LOG_UNKNOWN = 0,
+  ANDROID_LOG_DEFAULT,
+  ANDROID_LOG_VERBOSE,
+  ANDROID_LOG_DEBUG,
+  ANDROID_LOG_INFO,
+  ANDROID_LOG_WARN,
+  ANDROID_LOG_ERROR,
+  ANDROID_LOG_FATAL,
+  ANDROID_LOG_SILENT,
+};
+
+inline int __android_log_print(int priority, const char *tag, const char *fmt,
+                               ...) {
+  if (priority < ANDROID_LOG_WARN) return 0;
+  std::fprintf(stderr, "[%s] ", tag);
+  va_list args;
+  va_start(args, fmt);
+  const int written = std::vfprintf(stderr, fmt, args);
+  va_end(args);
+  std::fputc('\n', stderr);
+  return written;
+}
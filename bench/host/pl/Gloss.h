@@ -0,0 +1,15 @@
+#pragma once
+
+// Host stand-in for the parts of GlossHook the signature scanner uses; see
+// GlossHost.cpp.
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+
+void GlossInit(bool is_init_linker);
+
+uintptr_t GlossGetLibSection(const char *lib_name, const char *sec_name,
+                             size_t *sec_size);
+}
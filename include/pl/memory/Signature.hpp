@@ -3,9 +3,28 @@
 /**
  * @file Signature.hpp
  * @brief Signature resolver API.
+ *
+ * A signature is a list of hex bytes where `?` masks a nibble or a byte. It
+ * may end with `| op ...` to derive the returned address from the match:
+ * `+N`/`-N` moves by N bytes (decimal or 0x hex), `bl` follows the branch
+ * there, `adrp` follows the PC-relative address sequence there (ADR, ADRP +
+ * ADD/LDR, or Thumb MOVW/MOVT or LDR literal + ADD PC) and `*` loads the
+ * pointer stored there. For example `"?? ?? ?? 94 | bl"` or
+ * `"?? ?? ?? ?0 ?? ?? ?? 91 | adrp *"`.
+ *
+ * Signatures known at build time can be written as `sig<"...">` literals,
+ * which are parsed and checked by the compiler.
+ *
+ * A signature made only of identifier characters and not starting with a
+ * digit is first looked up as a symbol in the module's own symbol tables,
+ * .symtab included. Hex words like `"beef"` that name no symbol are then
+ * scanned for as patterns.
  */
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <span>
 #include <string>
 #include <string_view>
@@ -13,15 +32,53 @@
 #include <vector>
 
 #include "pl/Export.hpp"
+#include "pl/memory/SignaturePattern.hpp"
 
 namespace pl::memory {
 
+/**
+ * @brief Module memory covered by a signature scan.
+ */
+enum class SignatureScope {
+  Readable,   ///< Every readable mapping of the module.
+  Executable, ///< Executable mappings only.
+  Section,    ///< One named ELF section, e.g. ".text".
+};
+
+/**
+ * @brief Alignment of native instructions: 4 for A64, 2 for Thumb.
+ */
+#if defined(__arm__)
+inline constexpr size_t kCodeAlignment = 2;
+#else
+inline constexpr size_t kCodeAlignment = 4;
+#endif
+
+/**
+ * @brief Options for signature resolution.
+ *
+ * Signatures of instructions can set alignment to kCodeAlignment, which
+ * skips candidates at offsets where no instruction starts.
+ */
+struct SignatureScanOptions {
+  SignatureScope scope = SignatureScope::Readable;
+  std::string section;
+  size_t alignment = 1; ///< Matches start at multiples of this power of two.
+};
+
 /**
  * @brief Resolves one byte signature inside a loaded module.
  */
 PL_EXPORT uintptr_t resolveSignature(std::string_view signature,
                                      std::string_view moduleName);
 
+/**
+ * @brief Resolves one byte signature inside the given part of a module.
+ */
+PL_EXPORT uintptr_t resolveSignature(std::string_view signature,
+                                     std::string_view moduleName,
+                                     const SignatureScanOptions &options);
+
 /**
  * @brief Resolves multiple byte signatures inside a loaded module.
  */
@@ -29,4 +86,333 @@ PL_EXPORT std::unordered_map<std::string, uintptr_t>
 resolveSignatures(std::span<const std::string> signatures,
                   std::string_view moduleName);
 
+/**
+ * @brief Resolves multiple byte signatures inside the given part of a module.
+ */
+PL_EXPORT std::unordered_map<std::string, uintptr_t>
+resolveSignatures(std::span<const std::string> signatures,
+                  std::string_view moduleName,
+                  const SignatureScanOptions &options);
+
+/**
+ * @brief Resolves byte signatures into addresses, in the order of signatures.
+ *
+ * Nothing is keyed by signature text on the way, which keeps large rule sets
+ * cheap. Addresses not found are 0; addresses must have room for every
+ * signature, and only the first addresses.size() are resolved otherwise.
+ */
+PL_EXPORT void resolveSignatures(std::span<const std::string_view> signatures,
+                                 std::string_view moduleName,
+                                 std::span<uintptr_t> addresses,
+                                 const SignatureScanOptions &options = {});
+
+/**
+ * @brief Resolves sig<> literals into addresses, in the order of signatures.
+ */
+PL_EXPORT void
+resolveSignatures(std::span<const PrecompiledSignature> signatures,
+                  std::string_view moduleName, std::span<uintptr_t> addresses,
+                  const SignatureScanOptions &options = {});
+
+/**
+ * @brief A byte signature and the module it is resolved in.
+ */
+struct ModuleSignature {
+  std::string_view signature;
+  std::string_view moduleName;
+};
+
+/**
+ * @brief Resolves signatures of several modules in one batch.
+ *
+ * The modules share one snapshot of the loaded images and are scanned in
+ * parallel, each with a single matcher for all of its signatures. Addresses
+ * are in the order of signatures, as in the overload for one module.
+ */
+PL_EXPORT void resolveSignatures(std::span<const ModuleSignature> signatures,
+                                 std::span<uintptr_t> addresses,
+                                 const SignatureScanOptions &options = {});
+
+/**
+ * @brief Resolves one sig<> literal inside the given part of a module.
+ */
+PL_EXPORT uintptr_t resolveSignature(const PrecompiledSignature &signature,
+                                     std::string_view moduleName,
+                                     const SignatureScanOptions &options = {});
+
+/**
+ * @brief Resolves sig<> literals; addresses are in the order of signatures.
+ *
+ * The literals skip runtime parsing; results share the caches of the string
+ * overloads.
+ */
+PL_EXPORT std::vector<uintptr_t>
+resolveSignatures(std::span<const PrecompiledSignature> signatures,
+                  std::string_view moduleName,
+                  const SignatureScanOptions &options = {});
+
+/**
+ * @brief Resolves byte signatures in a module file before it is loaded.
+ *
+ * The file's PT_LOAD ranges are mapped read-only in load layout and scanned
+ * like the loaded module would be. Results are offsets from the module base,
+ * 0 when not found; signatures that dereference memory also yield 0 because
+ * the file is not relocated. Matches become offset hints for the module of
+ * that file name, so resolving them once it is loaded only verifies them.
+ */
+PL_EXPORT std::unordered_map<std::string, uintptr_t>
+resolveSignaturesInFile(std::span<const std::string> signatures,
+                        std::string_view path,
+                        const SignatureScanOptions &options = {});
+
+/**
+ * @brief Options for a detailed signature resolve.
+ */
+struct SignatureDetailOptions {
+  SignatureScanOptions scan;
+  size_t maxAddresses = 4;  ///< Addresses kept per signature.
+  size_t maxMatchCount = 64; ///< Saturation point of matchCount.
+};
+
+/**
+ * @brief Matches of one signature reported by a detailed resolve.
+ */
+struct SignatureMatchInfo {
+  uintptr_t address = 0;            ///< Lowest match, or 0 when none.
+  size_t matchCount = 0;            ///< Matches seen, saturating.
+  std::vector<uintptr_t> addresses; ///< Lowest matches in address order.
+  bool unique = false;              ///< True when exactly one match exists.
+};
+
+/**
+ * @brief Resolves signatures and reports how many places each one matches.
+ *
+ * Every signature is counted in the same single pass, so ambiguous patterns
+ * can be detected without extra scans. Results bypass the signature caches.
+ */
+PL_EXPORT std::unordered_map<std::string, SignatureMatchInfo>
+resolveSignaturesDetailed(std::span<const std::string> signatures,
+                          std::string_view moduleName,
+                          const SignatureDetailOptions &options = {});
+
+/**
+ * @brief Options for an approximate signature resolve.
+ */
+struct SignatureFuzzyOptions {
+  SignatureScanOptions scan;
+  size_t maxMismatches = 2; ///< Differing bytes allowed, at most 255.
+};
+
+/**
+ * @brief Closest match of one signature found by an approximate resolve.
+ */
+struct SignatureFuzzyMatch {
+  uintptr_t address = 0;          ///< Derived address, or 0 when none.
+  size_t distance = 0;            ///< Bytes that differ from the pattern.
+  std::vector<size_t> mismatches; ///< Indices of the differing pattern bytes.
+};
+
+/**
+ * @brief Resolves signatures allowing up to maxMismatches differing bytes.
+ *
+ * Each signature reports its closest match, the lowest among equally close
+ * ones, so a pattern broken by a changed immediate or register can still be
+ * located and tightened again offline. The scan is bit-parallel and linear
+ * in module size for any distance. Results bypass the signature caches.
+ */
+PL_EXPORT std::unordered_map<std::string, SignatureFuzzyMatch>
+resolveSignaturesFuzzy(std::span<const std::string> signatures,
+                       std::string_view moduleName,
+                       const SignatureFuzzyOptions &options = {});
+
+/**
+ * @brief Options for generating a signature.
+ */
+struct SignatureGenerateOptions {
+  size_t maxLength = 64;             ///< Longest pattern tried, in bytes.
+  size_t alignment = kCodeAlignment; ///< Alignment the result is unique at.
+  bool wildcardRelocations = true;   ///< Mask offsets and address immediates.
+};
+
+/**
+ * @brief Generates the shortest signature that matches only at address.
+ *
+ * Branch and literal offsets and the immediates of address sequences are
+ * masked, so the result survives relinking. The first call for a module and
+ * alignment builds a suffix index of the executable segments of its file,
+ * kept in the signature cache directory when one is set; every length tried
+ * is then an index lookup instead of a scan. Bytes and uniqueness are those
+ * of the file, so hooks installed in the loaded module do not change the
+ * result. Returns an empty string when address is not an aligned code
+ * address of the module, its file is not the loaded build, or nothing up to
+ * maxLength bytes is unique there.
+ */
+PL_EXPORT std::string
+generateSignature(uintptr_t address, std::string_view moduleName,
+                  const SignatureGenerateOptions &options = {});
+
+/**
+ * @brief Counts the aligned matches of a signature in a module's code.
+ *
+ * Uses the suffix index of generateSignature, so matches are counted in the
+ * module file; address ops are ignored.
+ */
+PL_EXPORT size_t countSignatureMatches(std::string_view signature,
+                                       std::string_view moduleName,
+                                       size_t alignment = kCodeAlignment);
+
+/**
+ * @brief Handle to a signature resolve running on a background thread.
+ */
+class SignatureFuture {
+public:
+  using Results = std::unordered_map<std::string, uintptr_t>;
+  using Callback = std::function<void(const Results &)>;
+  struct State;
+
+  SignatureFuture() = default;
+  explicit SignatureFuture(std::shared_ptr<State> state)
+      : mState(std::move(state)) {}
+
+  /** @brief Whether this handle refers to a resolve at all. */
+  [[nodiscard]] bool valid() const noexcept { return mState != nullptr; }
+
+  /** @brief Whether the resolve has finished, without blocking. */
+  [[nodiscard]] PL_EXPORT bool ready() const;
+
+  /** @brief Blocks until the resolve has finished. */
+  PL_EXPORT void wait() const;
+
+  /** @brief Blocks until the resolve has finished and returns its results. */
+  [[nodiscard]] PL_EXPORT const Results &get() const;
+
+  /**
+   * @brief Runs callback with the results once the resolve finishes.
+   *
+   * The callback runs on the scanning thread, or immediately on the calling
+   * thread when the resolve has already finished.
+   */
+  PL_EXPORT void onComplete(Callback callback) const;
+
+private:
+  std::shared_ptr<State> mState;
+};
+
+/**
+ * @brief Starts resolving signatures on a background thread.
+ *
+ * Results are the same as resolveSignatures and fill the same caches, so a
+ * later blocking resolve of the same signatures is served without a scan.
+ */
+PL_EXPORT SignatureFuture
+resolveSignaturesAsync(std::vector<std::string> signatures,
+                       std::string moduleName,
+                       SignatureScanOptions options = {});
+
+/**
+ * @brief Queues a signature to be resolved together with other requests.
+ *
+ * Requests made while mods load are batched and resolved before the first
+ * mod is enabled, with one scan per module and scope however many mods asked.
+ * The callback receives the address, or 0 when the signature is not found.
+ * Once that batch has run, new requests resolve immediately.
+ */
+PL_EXPORT void requestSignature(std::string signature,
+                                std::string moduleName,
+                                std::function<void(uintptr_t)> callback,
+                                SignatureScanOptions options = {});
+
+/**
+ * @brief Resolves every queued signature request and runs its callback.
+ */
+PL_EXPORT void resolveRequestedSignatures();
+
+/**
+ * @brief Sets the directory that persists resolved signature offsets.
+ *
+ * Offsets are stored per module build and re-verified against the pattern
+ * before reuse; the latest offset of each signature is also kept across
+ * builds as a search hint. An empty path disables the on-disk cache.
+ */
+PL_EXPORT void setSignatureCacheDirectory(std::string_view directory);
+
+/**
+ * @brief Remembers where a signature is expected inside a module.
+ *
+ * When the signature is not in the cache for the loaded build, windows that
+ * grow around moduleBase + offset are searched before the whole module. The
+ * offsets stored for earlier builds are used the same way; a hint set here
+ * takes precedence over them. A match found in a window is the one nearest
+ * the hint and may not be the lowest, so it is returned but not cached.
+ */
+PL_EXPORT void setSignatureOffsetHint(std::string_view moduleName,
+                                      std::string_view signature,
+                                      uintptr_t offset);
+
+/**
+ * @brief Keeps an index of a module's read-only bytes for later resolves.
+ *
+ * The index is built from the module file on a background thread, or mapped
+ * from the signature cache directory when an earlier launch stored one for
+ * the same build. Once it is ready, a pattern no cache answers is looked up
+ * in it instead of scanning the read-only mappings; writable mappings are
+ * still scanned. Candidates are verified in memory, so a match the shipped
+ * bytes have but a patch removed is rejected, while a match only a patch
+ * created is not found.
+ * A pattern is looked up only when exact 4-byte runs start at four
+ * consecutive offsets of it, as in any 7 exact bytes in a row.
+ */
+PL_EXPORT void enableSignatureIndex(std::string_view moduleName);
+
+/**
+ * @brief Counters and timings of signature resolves.
+ *
+ * Every resolve adds to the totals, whichever API started it. A signature is
+ * counted once per resolve, in the first step that answered it. Lookups that
+ * return early from addresses resolved before are not counted.
+ */
+struct SignatureStats {
+  uint64_t resolves = 0;              ///< Resolve calls.
+  uint64_t signatures = 0;            ///< Distinct signatures requested.
+  uint64_t addressCacheHits = 0;      ///< Answered by earlier resolves.
+  uint64_t symbolHits = 0;            ///< Found in the module's symbol tables.
+  uint64_t loaderSymbolHits = 0;      ///< Found only through dlsym.
+  uint64_t persistentCacheHits = 0;   ///< Verified at the offset cached for
+                                      ///< the module build.
+  uint64_t persistentCacheMisses = 0; ///< Patterns that cache did not answer.
+  uint64_t hintHits = 0;              ///< Found at or near an offset hint.
+  uint64_t hintMisses = 0;            ///< Hinted patterns left to the scan.
+  uint64_t indexedPatterns = 0;       ///< Patterns looked up in an index.
+  uint64_t scannedPatterns = 0;       ///< Patterns given to a full scan.
+  uint64_t notFound = 0;              ///< Signatures that resolved to 0.
+  uint64_t bytesScanned = 0;          ///< Bytes fed to the matchers.
+  uint64_t matcherStates = 0;         ///< States of the matchers built.
+  uint64_t candidates = 0;            ///< Anchor hits checked in full.
+  uint64_t verificationFailures = 0;  ///< Candidates that did not match.
+  uint64_t symbolNs = 0;              ///< Time in symbol lookups.
+  uint64_t cacheNs = 0;               ///< Time in the persistent cache.
+  uint64_t hintNs = 0;                ///< Time in hint searches.
+  uint64_t indexNs = 0;               ///< Time in index lookups.
+  uint64_t scanNs = 0;                ///< Time in full scans.
+  uint64_t totalNs = 0;               ///< Wall time of the resolves.
+};
+
+/**
+ * @brief Returns the totals since startup or the last reset.
+ *
+ * Fields are read one by one, so a resolve finishing meanwhile may show up in
+ * some of them only.
+ */
+PL_EXPORT SignatureStats getSignatureStats();
+
+/**
+ * @brief Sets every total back to zero.
+ */
+PL_EXPORT void resetSignatureStats();
+
+/**
+ * @brief Logs a one-line summary of each resolve at debug level when enabled.
+ */
+PL_EXPORT void setSignatureStatsLogging(bool enabled);
+
 } // namespace pl::memory
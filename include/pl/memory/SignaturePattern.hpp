@@ -0,0 +1,414 @@
+#pragma once
+
+/**
+ * @file SignaturePattern.hpp
+ * @brief Signature pattern grammar, usable at compile time.
+ */
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace pl::memory {
+
+/**
+ * @brief One pattern byte; bits cleared in mask are wildcards.
+ */
+struct SignatureByte {
+  uint8_t value = 0;
+  uint8_t mask = 0;
+};
+
+/**
+ * @brief Step that derives the returned address from a match.
+ */
+enum class SignatureOpKind : uint8_t {
+  Offset,      ///< Move by offset bytes.
+  Branch,      ///< Follow the branch instruction.
+  PcRelative,  ///< Follow the PC-relative address sequence.
+  Dereference, ///< Load the pointer stored at the address.
+};
+
+struct SignatureOp {
+  SignatureOpKind kind = SignatureOpKind::Offset;
+  int64_t offset = 0;
+};
+
+/**
+ * @brief Bytes located first when scanning, before the rest is verified.
+ */
+struct SignatureAnchor {
+  size_t index = 0;
+  size_t size = 1;
+};
+
+/** @brief Longest exact byte run used as an anchor. */
+inline constexpr size_t kMaxSignatureAnchorSize = 8;
+
+namespace detail {
+
+constexpr int hexDigit(char ch) {
+  if (ch >= '0' && ch <= '9') return ch - '0';
+  if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+  if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+  return -1;
+}
+
+constexpr bool isSpace(char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' ||
+         ch == '\v';
+}
+
+// How often each byte value occurs in release arm64 and armv7/Thumb code, per
+// 65536 bytes, with relocated instruction fields left out.
+inline constexpr std::array<uint16_t, 256> kA64ByteFrequency{
+    7729, 2618, 1425, 3780, 374, 376, 368, 339, 1044, 753, 627, 357,
+    217, 204, 93, 249, 91, 185, 196, 503, 822, 317, 312, 346,
+    160, 197, 176, 119, 83, 102, 104, 1443, 216, 207, 125, 252,
+    20, 20, 32, 41, 281, 222, 594, 114, 52, 20, 14, 19,
+    28, 77, 47, 68, 134, 73, 215, 92, 64, 431, 6, 36,
+    91, 64, 9, 288, 2396, 397, 326, 249, 102, 68, 56, 33,
+    139, 109, 119, 114, 60, 18, 17, 538, 15, 31, 1007, 61,
+    1018, 23, 31, 268, 19, 22, 22, 22, 17, 22, 22, 657,
+    299, 170, 63, 176, 18, 10, 12, 87, 408, 165, 142, 213,
+    63, 45, 10, 102, 10, 442, 125, 28, 45, 23, 27, 14,
+    5, 143, 36, 68, 29, 104, 33, 180, 1357, 161, 88, 184,
+    24, 27, 54, 10, 277, 192, 128, 303, 86, 74, 14, 10,
+    19, 1095, 88, 92, 26, 41, 23, 13, 6, 12, 229, 74,
+    8, 9, 12, 166, 192, 89, 91, 95, 9, 28, 18, 10,
+    252, 1461, 2397, 43, 22, 157, 13, 27, 3, 24, 107, 56,
+    679, 158, 13, 12, 50, 445, 37, 13, 5, 35, 19, 125,
+    516, 120, 50, 150, 9, 1, 12, 1, 101, 64, 28, 111,
+    46, 24, 5, 5, 13, 156, 9, 109, 14, 41, 355, 12,
+    12, 10, 13, 5, 8, 9, 5, 42, 1255, 662, 302, 337,
+    135, 42, 35, 28, 470, 180, 98, 564, 72, 23, 22, 27,
+    27, 116, 55, 365, 613, 180, 312, 101, 583, 2202, 150, 51,
+    135, 212, 584, 1001};
+
+inline constexpr std::array<uint16_t, 256> kThumbByteFrequency{
+    4455, 1971, 1141, 745, 1246, 534, 562, 678, 935, 311, 398, 302,
+    391, 272, 341, 462, 833, 206, 184, 144, 158, 79, 145, 88,
+    397, 133, 210, 125, 266, 93, 81, 185, 1542, 497, 618, 493,
+    218, 252, 130, 141, 1034, 330, 187, 191, 101, 187, 85, 158,
+    542, 207, 117, 112, 108, 50, 70, 54, 262, 105, 78, 83,
+    59, 27, 39, 157, 810, 334, 969, 200, 1324, 211, 2860, 167,
+    507, 406, 276, 91, 85, 93, 90, 935, 244, 94, 105, 77,
+    52, 52, 57, 48, 126, 48, 72, 86, 60, 26, 54, 71,
+    592, 185, 153, 95, 46, 51, 61, 28, 1099, 243, 130, 32,
+    48, 21, 25, 108, 600, 134, 97, 80, 29, 21, 39, 38,
+    528, 400, 253, 55, 50, 27, 78, 157, 677, 318, 190, 107,
+    92, 44, 68, 42, 219, 80, 98, 59, 27, 110, 41, 98,
+    321, 183, 53, 85, 114, 47, 26, 47, 312, 187, 212, 59,
+    46, 123, 39, 64, 277, 61, 47, 40, 22, 24, 53, 11,
+    156, 207, 62, 47, 67, 318, 95, 90, 599, 612, 116, 174,
+    74, 231, 31, 24, 134, 127, 68, 55, 58, 436, 64, 777,
+    513, 90, 59, 48, 67, 47, 27, 54, 57, 64, 84, 40,
+    25, 252, 98, 233, 714, 499, 140, 113, 117, 55, 26, 24,
+    249, 86, 127, 149, 211, 169, 41, 28, 686, 70, 27, 13,
+    53, 74, 39, 153, 209, 515, 403, 301, 19, 68, 14, 35,
+    1451, 696, 607, 153, 456, 343, 494, 34, 1792, 134, 92, 25,
+    35, 2, 24, 230};
+
+#if defined(__arm__)
+inline constexpr const auto &kCodeByteFrequency = kThumbByteFrequency;
+#else
+inline constexpr const auto &kCodeByteFrequency = kA64ByteFrequency;
+#endif
+
+// floor(4 * log2(value)) for value in [1, 65536].
+constexpr int quarterLog2(uint32_t value) {
+  const int exponent = std::bit_width(value) - 1;
+  if (exponent >= 16) return 64;
+  const uint64_t square = uint64_t{value} * value;
+  const uint64_t fourth = square * square;
+  int quarters = 0;
+  while (quarters < 3 &&
+         fourth >= uint64_t{1} << (4 * exponent + quarters + 1)) {
+    ++quarters;
+  }
+  return 4 * exponent + quarters;
+}
+
+// Information a matching byte carries, in quarter bits: rare values score
+// high, wildcards score 0.
+constexpr int byteRarity(SignatureByte byte) {
+  if (byte.mask == 0) return 0;
+  uint32_t hits = 0;
+  if (byte.mask == 0xFF) {
+    hits = kCodeByteFrequency[byte.value];
+  } else {
+    // Walks the subsets of the unchecked bits, so a masked nibble costs 16
+    // lookups rather than 256.
+    const uint32_t free = ~static_cast<uint32_t>(byte.mask) & 0xFF;
+    for (uint32_t bits = free;; bits = (bits - 1) & free) {
+      hits += kCodeByteFrequency[byte.value | bits];
+      if (bits == 0) break;
+    }
+  }
+  return quarterLog2(65536) - quarterLog2(hits);
+}
+
+constexpr bool parseByte(std::string_view token, SignatureByte &byte) {
+  if (token == "?" || token == "??") {
+    byte = SignatureByte{};
+    return true;
+  }
+  if (token.size() != 2) return false;
+
+  uint8_t value = 0;
+  uint8_t mask = 0;
+  for (size_t i = 0; i < token.size(); ++i) {
+    if (token[i] == '?') continue;
+    const int digit = hexDigit(token[i]);
+    if (digit < 0) return false;
+    const auto shift = static_cast<unsigned>((1 - i) * 4);
+    value |= static_cast<uint8_t>(digit << shift);
+    mask |= static_cast<uint8_t>(0xF << shift);
+  }
+  byte = SignatureByte{value, mask};
+  return true;
+}
+
+template <typename Sink>
+constexpr bool parseByteToken(std::string_view token, Sink &sink) {
+  SignatureByte byte;
+  if (parseByte(token, byte)) return sink.addByte(byte);
+  if (token.empty() || token.size() % 2 != 0) return false;
+
+  for (size_t pos = 0; pos < token.size(); pos += 2) {
+    if (!parseByte(token.substr(pos, 2), byte) || !sink.addByte(byte)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+constexpr bool parseOffset(std::string_view token, int64_t &offset) {
+  const bool negative = token.front() == '-';
+  token.remove_prefix(1);
+  uint64_t base = 10;
+  if (token.size() > 2 && token[0] == '0' && (token[1] | 0x20) == 'x') {
+    token.remove_prefix(2);
+    base = 16;
+  }
+  if (token.empty()) return false;
+
+  uint64_t value = 0;
+  for (const char ch : token) {
+    const int digit = hexDigit(ch);
+    if (digit < 0 || static_cast<uint64_t>(digit) >= base) return false;
+    if (value > (INT64_MAX - static_cast<uint64_t>(digit)) / base) {
+      return false;
+    }
+    value = value * base + static_cast<uint64_t>(digit);
+  }
+  offset = negative ? -static_cast<int64_t>(value)
+                    : static_cast<int64_t>(value);
+  return true;
+}
+
+constexpr bool parseOp(std::string_view token, SignatureOp &op) {
+  if (token == "bl" || token == "b") {
+    op = SignatureOp{SignatureOpKind::Branch, 0};
+  } else if (token == "adrp" || token == "adr") {
+    op = SignatureOp{SignatureOpKind::PcRelative, 0};
+  } else if (token == "*") {
+    op = SignatureOp{SignatureOpKind::Dereference, 0};
+  } else if (token.front() == '+' || token.front() == '-') {
+    op.kind = SignatureOpKind::Offset;
+    return parseOffset(token, op.offset);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+template <typename Fn>
+constexpr bool forEachToken(std::string_view text, Fn &&fn) {
+  size_t pos = 0;
+  while (pos < text.size()) {
+    while (pos < text.size() && isSpace(text[pos])) ++pos;
+    if (pos >= text.size()) break;
+
+    const size_t start = pos;
+    while (pos < text.size() && !isSpace(text[pos])) ++pos;
+    if (!fn(text.substr(start, pos - start))) return false;
+  }
+  return true;
+}
+
+} // namespace detail
+
+/**
+ * @brief Parses signature text, handing every byte and op to sink.
+ *
+ * Sink provides `bool addByte(SignatureByte)` and `bool addOp(SignatureOp)`.
+ * Returns false when the text is malformed or the sink rejects an element.
+ */
+template <typename Sink>
+constexpr bool parseSignature(std::string_view text, Sink &sink) {
+  const size_t separator = text.find('|');
+  const bool bytes = detail::forEachToken(
+      text.substr(0, separator), [&sink](std::string_view token) {
+        return detail::parseByteToken(token, sink);
+      });
+  if (!bytes || separator == std::string_view::npos) return bytes;
+
+  return detail::forEachToken(
+      text.substr(separator + 1), [&sink](std::string_view token) {
+        SignatureOp op;
+        return detail::parseOp(token, op) && sink.addOp(op);
+      });
+}
+
+/**
+ * @brief Chooses the bytes a scan looks for first.
+ *
+ * Picks the rarest anchor by the byte frequencies of typical code: a window
+ * of up to kMaxSignatureAnchorSize exact bytes, or a pair of adjacent checked
+ * bytes when that is rarer, the latest one on ties. Only patterns without
+ * either fall back to the rarest single checked byte.
+ */
+constexpr SignatureAnchor
+selectSignatureAnchor(std::span<const SignatureByte> bytes) {
+  SignatureAnchor anchor;
+  int bestScore = 0;
+  auto consider = [&](size_t index, size_t size, int score) {
+    if (score > bestScore || (score == bestScore && index > anchor.index)) {
+      anchor = SignatureAnchor{index, size};
+      bestScore = score;
+    }
+  };
+
+  for (size_t runStart = 0; runStart < bytes.size();) {
+    if (bytes[runStart].mask != 0xFF) {
+      ++runStart;
+      continue;
+    }
+
+    size_t runEnd = runStart + 1;
+    while (runEnd < bytes.size() && bytes[runEnd].mask == 0xFF) ++runEnd;
+
+    const size_t size = runEnd - runStart < kMaxSignatureAnchorSize
+                            ? runEnd - runStart
+                            : kMaxSignatureAnchorSize;
+    for (size_t start = runStart; start + size <= runEnd; ++start) {
+      int score = 0;
+      for (size_t i = start; i < start + size; ++i) {
+        score += detail::byteRarity(bytes[i]);
+      }
+      consider(start, size, score);
+    }
+    runStart = runEnd;
+  }
+
+  // Two adjacent checked bytes still make a selective masked anchor; a pair
+  // of exact bytes is already covered by the windows above.
+  bool hasPair = false;
+  for (size_t i = 0; i + 1 < bytes.size(); ++i) {
+    if (bytes[i].mask == 0 || bytes[i + 1].mask == 0) continue;
+    hasPair = true;
+    if (bytes[i].mask == 0xFF && bytes[i + 1].mask == 0xFF) continue;
+    consider(i, 2,
+             detail::byteRarity(bytes[i]) + detail::byteRarity(bytes[i + 1]));
+  }
+  if (hasPair) return anchor;
+
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    if (bytes[i].mask != 0) consider(i, 1, detail::byteRarity(bytes[i]));
+  }
+  return anchor;
+}
+
+/**
+ * @brief String literal usable as a template argument of sig.
+ */
+template <size_t N> struct SignatureText {
+  char value[N]{};
+
+  consteval SignatureText(const char (&text)[N]) {
+    for (size_t i = 0; i < N; ++i) value[i] = text[i];
+  }
+
+  [[nodiscard]] constexpr std::string_view view() const {
+    return {value, N - 1};
+  }
+};
+
+/**
+ * @brief Signature parsed at compile time; see sig.
+ */
+struct PrecompiledSignature {
+  std::string_view text;
+  std::span<const SignatureByte> bytes;
+  std::span<const SignatureOp> ops;
+  SignatureAnchor anchor;
+};
+
+namespace detail {
+
+struct SignatureCounts {
+  size_t bytes = 0;
+  size_t ops = 0;
+
+  constexpr bool addByte(SignatureByte) { return ++bytes != 0; }
+  constexpr bool addOp(SignatureOp) { return ++ops != 0; }
+};
+
+template <size_t Bytes, size_t Ops> struct SignatureStorage {
+  std::array<SignatureByte, Bytes> bytes{};
+  std::array<SignatureOp, Ops> ops{};
+  size_t byteCount = 0;
+  size_t opCount = 0;
+
+  constexpr bool addByte(SignatureByte byte) {
+    bytes[byteCount++] = byte;
+    return true;
+  }
+  constexpr bool addOp(SignatureOp op) {
+    ops[opCount++] = op;
+    return true;
+  }
+};
+
+// Deliberately not constexpr: reaching it turns a bad literal into a build
+// error that names this function.
+void invalidSignaturePattern();
+
+consteval SignatureCounts countSignature(std::string_view text) {
+  SignatureCounts counts;
+  if (!parseSignature(text, counts) || counts.bytes == 0) {
+    invalidSignaturePattern();
+  }
+  return counts;
+}
+
+template <SignatureText Text> struct PrecompiledSignatureData {
+  static constexpr SignatureCounts counts = countSignature(Text.view());
+  static constexpr auto storage = [] {
+    SignatureStorage<counts.bytes, counts.ops> result;
+    parseSignature(Text.view(), result);
+    return result;
+  }();
+  static constexpr SignatureAnchor anchor =
+      selectSignatureAnchor(storage.bytes);
+};
+
+} // namespace detail
+
+/**
+ * @brief Signature literal parsed and validated at compile time.
+ *
+ * `pl::memory::sig<"48 8B ?? ?? | bl">` yields a PrecompiledSignature whose
+ * bytes, ops and anchor are constants; malformed text fails the build.
+ */
+template <SignatureText Text>
+inline constexpr PrecompiledSignature sig{
+    Text.view(), detail::PrecompiledSignatureData<Text>::storage.bytes,
+    detail::PrecompiledSignatureData<Text>::storage.ops,
+    detail::PrecompiledSignatureData<Text>::anchor};
+
+} // namespace pl::memory
@@ -5,6 +5,7 @@
 
 #include "pl/Logger.hpp"
 #include "pl/internal/ModManager.h"
+#include "pl/memory/Signature.hpp"
 #include "pl/runtime/GameHooks.h"
 #include "pl/runtime/JavaRuntime.h"
 #include "pl/runtime/ModMenuBridge.h"
@@ -103,6 +104,8 @@ Java_org_levimc_launcher_core_minecraft_MinecraftRuntimePreparer_nativeSetupRunt
   }
 
   preloaderLogger.debug("Native runtime mod directory: {}", path);
+  pl::memory::setSignatureCacheDirectory(
+      (std::filesystem::path(path) / ".signature-cache").string());
   env->ReleaseStringUTFChars(modsPath, path);
 }
 
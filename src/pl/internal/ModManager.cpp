@@ -9,6 +9,7 @@
 #include "pl/internal/LoadedModRegistry.h"
 #include "pl/internal/ModManifest.h"
 #include "pl/internal/NativeModLifecycle.h"
+#include "pl/memory/Signature.hpp"
 
 bool ModManager::LoadModLibrary(
     const std::filesystem::path &libraryPath,
@@ -51,6 +52,10 @@ bool ModManager::LoadModLibrary(
 void ModManager::EnableLoadedMods() {
   using namespace pl::internal::mod;
 
+  // Signatures requested from every mod's load phase share one scan per
+  // module, and their callbacks have run before any enable hook does.
+  pl::memory::resolveRequestedSignatures();
+
   const auto keys = getLoadedModKeysSnapshot();
   for (const auto &key : keys) {
     const auto entry = getLoadedModEntry(key);
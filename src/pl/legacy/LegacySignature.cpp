@@ -1,5 +1,9 @@
 #include "pl/legacy/LegacySignature.h"
 
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
 #include "pl/memory/Signature.hpp"
 
 extern "C" {
@@ -12,4 +16,35 @@ PL_LEGACY_EXPORT uintptr_t pl_resolve_signature(const char *signature,
   return pl::memory::resolveSignature(signature, moduleName);
 }
 
+// Fills addresses[i] for signatures[i] and returns how many were found; null
+// signatures resolve to 0.
+PL_LEGACY_EXPORT size_t pl_resolve_signatures(const char **signatures,
+                                              size_t count,
+                                              const char *moduleName,
+                                              uintptr_t *addresses) {
+  if (!addresses) {
+    return 0;
+  }
+  std::fill(addresses, addresses + count, 0);
+  if (!signatures || !moduleName) {
+    return 0;
+  }
+
+  std::vector<std::string_view> views;
+  std::vector<size_t> slots;
+  views.reserve(count);
+  slots.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (!signatures[i]) continue;
+    views.emplace_back(signatures[i]);
+    slots.push_back(i);
+  }
+  std::vector<uintptr_t> found(views.size(), 0);
+  pl::memory::resolveSignatures(views, moduleName, found);
+  for (size_t i = 0; i < slots.size(); ++i) {
+    addresses[slots[i]] = found[i];
+  }
+  return views.size() - std::count(found.begin(), found.end(), 0);
+}
+
 } // extern "C"
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "pl/legacy/LegacyMacro.h"
@@ -11,6 +12,11 @@ extern "C" {
 PL_LEGACY_EXPORT uintptr_t pl_resolve_signature(const char *signature,
                                                 const char *moduleName);
 
+PL_LEGACY_EXPORT size_t pl_resolve_signatures(const char **signatures,
+                                              size_t count,
+                                              const char *moduleName,
+                                              uintptr_t *addresses);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,239 @@
+#include "pl/memory/ElfSymbols.h"
+
+#include <cstring>
+#include <link.h>
+
+#include "pl/memory/ModuleFile.h"
+
+namespace pl::memory {
+namespace {
+
+constexpr ElfW(Half) kHiddenVersion = 0x8000;
+
+// Bounds-checked view of an image's readable segments, so corrupt dynamic
+// tables cannot send a lookup outside them.
+class ImageReader {
+public:
+  explicit ImageReader(const LoadedModule &image) : mImage(image) {}
+
+  template <typename T>
+  const T *at(uintptr_t address, size_t count = 1) const {
+    if (count > SIZE_MAX / sizeof(T)) return nullptr;
+    const size_t size = count * sizeof(T);
+    for (const auto &segment : mImage.segments) {
+      if (segment.readable && address >= segment.start &&
+          address <= segment.end && size <= segment.end - address) {
+        return reinterpret_cast<const T *>(address);
+      }
+    }
+    return nullptr;
+  }
+
+  // Dynamic entries hold link-time addresses, except where the loader has
+  // relocated them in place as glibc does.
+  uintptr_t pointer(uintptr_t value) const {
+    return value >= mImage.base && mImage.base != 0 ? value
+                                                     : mImage.base + value;
+  }
+
+private:
+  const LoadedModule &mImage;
+};
+
+struct DynamicTables {
+  const ElfW(Sym) *symbols = nullptr;
+  const char *strings = nullptr;
+  size_t stringsSize = 0;
+  const ElfW(Half) *versions = nullptr;
+  uintptr_t gnuHash = 0;
+  uintptr_t sysvHash = 0;
+};
+
+bool readDynamicTables(const LoadedModule &image, const ImageReader &reader,
+                       DynamicTables &tables) {
+  uintptr_t symbols = 0;
+  uintptr_t strings = 0;
+  uintptr_t versions = 0;
+  for (uintptr_t at = image.dynamic;; at += sizeof(ElfW(Dyn))) {
+    const auto *entry = reader.at<ElfW(Dyn)>(at);
+    if (!entry || entry->d_tag == DT_NULL) break;
+    switch (entry->d_tag) {
+    case DT_SYMTAB:
+      symbols = reader.pointer(entry->d_un.d_ptr);
+      break;
+    case DT_STRTAB:
+      strings = reader.pointer(entry->d_un.d_ptr);
+      break;
+    case DT_STRSZ:
+      tables.stringsSize = entry->d_un.d_val;
+      break;
+    case DT_VERSYM:
+      versions = reader.pointer(entry->d_un.d_ptr);
+      break;
+    case DT_GNU_HASH:
+      tables.gnuHash = reader.pointer(entry->d_un.d_ptr);
+      break;
+    case DT_HASH:
+      tables.sysvHash = reader.pointer(entry->d_un.d_ptr);
+      break;
+    default:
+      break;
+    }
+  }
+  tables.strings = reader.at<char>(strings, tables.stringsSize);
+  tables.symbols = reader.at<ElfW(Sym)>(symbols);
+  tables.versions = versions ? reader.at<ElfW(Half)>(versions) : nullptr;
+  return tables.symbols && tables.strings &&
+         (tables.gnuHash != 0 || tables.sysvHash != 0);
+}
+
+uint32_t gnuHash(std::string_view name) {
+  uint32_t hash = 5381;
+  for (const char ch : name) hash = hash * 33 + static_cast<unsigned char>(ch);
+  return hash;
+}
+
+uint32_t sysvHash(std::string_view name) {
+  uint32_t hash = 0;
+  for (const char ch : name) {
+    hash = (hash << 4) + static_cast<unsigned char>(ch);
+    const uint32_t high = hash & 0xf0000000;
+    if (high) hash ^= high >> 24;
+    hash &= ~high;
+  }
+  return hash;
+}
+
+// Address of symbol index if it is a usable definition of name, else 0. Like
+// dlsym without a version, hidden (non-default) versions are skipped.
+uintptr_t matchSymbol(const LoadedModule &image, const ImageReader &reader,
+                      const DynamicTables &tables, uint32_t index,
+                      std::string_view name) {
+  const auto *symbol =
+      reader.at<ElfW(Sym)>(reinterpret_cast<uintptr_t>(tables.symbols) +
+                           index * sizeof(ElfW(Sym)));
+  if (!symbol || symbol->st_name >= tables.stringsSize ||
+      tables.stringsSize - symbol->st_name <= name.size() ||
+      std::memcmp(tables.strings + symbol->st_name, name.data(),
+                  name.size()) != 0 ||
+      tables.strings[symbol->st_name + name.size()] != '\0') {
+    return 0;
+  }
+
+  const auto type = symbol->st_info & 0xf;
+  if (symbol->st_shndx == SHN_UNDEF || symbol->st_value == 0 ||
+      type == STT_TLS || type == STT_GNU_IFUNC) {
+    return 0;
+  }
+  if (tables.versions) {
+    const auto *version = reader.at<ElfW(Half)>(
+        reinterpret_cast<uintptr_t>(tables.versions) +
+        index * sizeof(ElfW(Half)));
+    if (!version || (*version & kHiddenVersion) != 0 || *version == 0) {
+      return 0;
+    }
+  }
+  return image.base + symbol->st_value;
+}
+
+uintptr_t findGnuHashSymbol(const LoadedModule &image,
+                            const ImageReader &reader,
+                            const DynamicTables &tables,
+                            std::string_view name) {
+  const auto *header = reader.at<uint32_t>(tables.gnuHash, 4);
+  if (!header || header[0] == 0 || header[2] == 0) return 0;
+  const uint32_t bucketCount = header[0];
+  const uint32_t symbolOffset = header[1];
+  const uint32_t bloomSize = header[2];
+  const uint32_t bloomShift = header[3];
+  constexpr uint32_t kBloomBits = sizeof(ElfW(Addr)) * 8;
+
+  const uintptr_t bloomAt = tables.gnuHash + 4 * sizeof(uint32_t);
+  const auto *bloom = reader.at<ElfW(Addr)>(bloomAt, bloomSize);
+  const uintptr_t bucketsAt = bloomAt + bloomSize * sizeof(ElfW(Addr));
+  const auto *buckets = reader.at<uint32_t>(bucketsAt, bucketCount);
+  if (!bloom || !buckets) return 0;
+  const uintptr_t chainAt = bucketsAt + bucketCount * sizeof(uint32_t);
+
+  const uint32_t hash = gnuHash(name);
+  const ElfW(Addr) word = bloom[(hash / kBloomBits) % bloomSize];
+  const ElfW(Addr) mask = (ElfW(Addr){1} << (hash % kBloomBits)) |
+                          (ElfW(Addr){1} << ((hash >> bloomShift) % kBloomBits));
+  if ((word & mask) != mask) return 0;
+
+  uint32_t index = buckets[hash % bucketCount];
+  if (index < symbolOffset) return 0;
+  for (;; ++index) {
+    const auto *chain = reader.at<uint32_t>(
+        chainAt + (index - symbolOffset) * sizeof(uint32_t));
+    if (!chain) return 0;
+    if ((*chain | 1) == (hash | 1)) {
+      if (const uintptr_t address =
+              matchSymbol(image, reader, tables, index, name)) {
+        return address;
+      }
+    }
+    if (*chain & 1) return 0;
+  }
+}
+
+uintptr_t findSysvHashSymbol(const LoadedModule &image,
+                             const ImageReader &reader,
+                             const DynamicTables &tables,
+                             std::string_view name) {
+  const auto *header = reader.at<uint32_t>(tables.sysvHash, 2);
+  if (!header || header[0] == 0) return 0;
+  const uint32_t bucketCount = header[0];
+  const uint32_t chainCount = header[1];
+  const auto *buckets = reader.at<uint32_t>(
+      tables.sysvHash + 2 * sizeof(uint32_t), bucketCount + chainCount);
+  if (!buckets) return 0;
+  const auto *chains = buckets + bucketCount;
+
+  uint32_t steps = 0;
+  for (uint32_t index = buckets[sysvHash(name) % bucketCount];
+       index != 0 && index < chainCount && steps++ < chainCount;
+       index = chains[index]) {
+    if (const uintptr_t address =
+            matchSymbol(image, reader, tables, index, name)) {
+      return address;
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+std::vector<uintptr_t> findElfSymbols(const LoadedModule &image,
+                                      std::span<const std::string_view> names) {
+  std::vector<uintptr_t> addresses(names.size());
+  if (names.empty()) return addresses;
+
+  const ImageReader reader(image);
+  DynamicTables tables;
+  bool missing = false;
+  if (image.dynamic != 0 && readDynamicTables(image, reader, tables)) {
+    for (size_t i = 0; i < names.size(); ++i) {
+      addresses[i] = tables.gnuHash != 0
+                         ? findGnuHashSymbol(image, reader, tables, names[i])
+                         : findSysvHashSymbol(image, reader, tables, names[i]);
+      missing |= addresses[i] == 0;
+    }
+  } else {
+    missing = true;
+  }
+  if (!missing) return addresses;
+
+  // Names already found get a placeholder so the file pass skips them.
+  std::vector<uintptr_t> values(names.size());
+  for (size_t i = 0; i < names.size(); ++i) values[i] = addresses[i] != 0;
+  readFileSymbols(image.path, image.buildId, names, values);
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (addresses[i] == 0 && values[i] != 0) {
+      addresses[i] = image.base + values[i];
+    }
+  }
+  return addresses;
+}
+
+} // namespace pl::memory
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "pl/memory/ModuleMap.h"
+
+namespace pl::memory {
+
+// Looks names up in the image's own symbol tables, without the dynamic
+// linker: the dynamic symbols through their GNU or SysV hash table, then the
+// .symtab of the image's file for whatever is still missing. Addresses are in
+// the order of names, 0 for names the image does not define and for IFUNC and
+// TLS symbols, whose addresses only the linker can compute.
+std::vector<uintptr_t> findElfSymbols(const LoadedModule &image,
+                                      std::span<const std::string_view> names);
+
+} // namespace pl::memory
@@ -0,0 +1,184 @@
+#include "pl/memory/GramIndex.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+namespace pl::memory {
+namespace {
+
+constexpr char kIndexMagic[8] = {'p', 'l', 'g', 'r', 'a', 'm', '2', 0};
+
+struct IndexHeader {
+  char magic[8] = {};
+  uint32_t gramStep = 0;
+  uint32_t bucketBits = 0;
+  uint64_t rangeCount = 0;
+  uint64_t postingCount = 0;
+};
+
+uint32_t hashGram(const uint8_t *data) {
+  uint32_t gram = 0;
+  std::memcpy(&gram, data, sizeof(gram));
+  return (gram * 0x9E3779B1u) >> (32 - GramIndex::kBucketBits);
+}
+
+// Calls visit(address) for every indexed gram of ranges, in address order.
+template <typename Visit>
+void forEachGram(std::span<const IndexedRange> ranges, Visit visit) {
+  constexpr uintptr_t step = GramIndex::kGramStep;
+  for (const auto &range : ranges) {
+    if (range.end - range.start < GramIndex::kGramSize) continue;
+    const uintptr_t last = range.end - GramIndex::kGramSize;
+    for (uintptr_t address = (range.start + step - 1) & ~(step - 1);
+         address <= last; address += step) {
+      visit(address);
+    }
+  }
+}
+
+size_t getFileSize(size_t rangeCount, size_t postingCount) {
+  return sizeof(IndexHeader) + rangeCount * 2 * sizeof(uint64_t) +
+         (GramIndex::kBucketCount + 1 + postingCount) * sizeof(uint32_t);
+}
+
+} // namespace
+
+GramIndex::GramIndex(uintptr_t base, std::vector<IndexedRange> ranges)
+    : mBase(base), mRanges(std::move(ranges)) {}
+
+GramIndex::~GramIndex() {
+  if (mMapping) munmap(mMapping, mMappingSize);
+}
+
+std::unique_ptr<GramIndex>
+GramIndex::build(uintptr_t base, std::vector<IndexedRange> ranges,
+                 uintptr_t image, const std::filesystem::path &path) {
+  for (const auto &range : ranges) {
+    if (range.start < base || range.end < range.start ||
+        range.end - base > UINT32_MAX) {
+      return nullptr;
+    }
+  }
+  std::unique_ptr<GramIndex> index(new GramIndex(base, std::move(ranges)));
+
+  // Counting sort: one pass sizes the buckets, the second fills them in
+  // address order, which leaves every bucket sorted.
+  const auto bytesAt = [base, image](uintptr_t address) {
+    return reinterpret_cast<const uint8_t *>(image + (address - base));
+  };
+  auto &storage = index->mStorage;
+  storage.assign(kBucketCount + 1, 0);
+  forEachGram(index->mRanges, [&](uintptr_t address) {
+    ++storage[hashGram(bytesAt(address)) + 1];
+  });
+  for (size_t i = 1; i <= kBucketCount; ++i) storage[i] += storage[i - 1];
+  std::vector<uint32_t> next(storage.begin(), storage.end() - 1);
+  storage.resize(kBucketCount + 1 + storage.back());
+  forEachGram(index->mRanges, [&](uintptr_t address) {
+    const uint32_t bucket = hashGram(bytesAt(address));
+    storage[kBucketCount + 1 + next[bucket]++] =
+        static_cast<uint32_t>(address - base);
+  });
+  index->mBuckets = std::span(storage).first(kBucketCount + 1);
+  index->mPostings = std::span(storage).subspan(kBucketCount + 1);
+  if (path.empty()) return index;
+
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+  auto tempPath = path;
+  tempPath += ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) return index;
+    IndexHeader header;
+    std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    header.gramStep = kGramStep;
+    header.bucketBits = kBucketBits;
+    header.rangeCount = index->mRanges.size();
+    header.postingCount = index->mPostings.size();
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto &range : index->mRanges) {
+      const uint64_t bounds[2] = {range.start - base, range.end - base};
+      file.write(reinterpret_cast<const char *>(bounds), sizeof(bounds));
+    }
+    file.write(reinterpret_cast<const char *>(storage.data()),
+               static_cast<std::streamsize>(storage.size() *
+                                            sizeof(uint32_t)));
+    if (!file) return index;
+  }
+  std::filesystem::rename(tempPath, path, error);
+  if (error) return index;
+
+  auto mapped = open(base, index->mRanges, path);
+  return mapped ? std::move(mapped) : std::move(index);
+}
+
+std::unique_ptr<GramIndex>
+GramIndex::open(uintptr_t base, std::vector<IndexedRange> ranges,
+                const std::filesystem::path &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return nullptr;
+  struct stat status {};
+  void *mapping = MAP_FAILED;
+  const bool sized = fstat(fd, &status) == 0 &&
+                     static_cast<size_t>(status.st_size) >= sizeof(IndexHeader);
+  if (sized) {
+    mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ,
+                   MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (mapping == MAP_FAILED) return nullptr;
+
+  std::unique_ptr<GramIndex> index(new GramIndex(base, std::move(ranges)));
+  index->mMapping = mapping;
+  index->mMappingSize = static_cast<size_t>(status.st_size);
+
+  const auto *bytes = static_cast<const uint8_t *>(mapping);
+  IndexHeader header;
+  std::memcpy(&header, bytes, sizeof(header));
+  if (std::memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+      header.gramStep != kGramStep || header.bucketBits != kBucketBits ||
+      header.rangeCount != index->mRanges.size() ||
+      header.postingCount > UINT32_MAX ||
+      getFileSize(header.rangeCount, header.postingCount) !=
+          index->mMappingSize) {
+    return nullptr;
+  }
+  const auto *bounds =
+      reinterpret_cast<const uint64_t *>(bytes + sizeof(IndexHeader));
+  for (const auto &range : index->mRanges) {
+    if (bounds[0] != range.start - base || bounds[1] != range.end - base) {
+      return nullptr;
+    }
+    bounds += 2;
+  }
+
+  const auto *table = reinterpret_cast<const uint32_t *>(bounds);
+  index->mBuckets = std::span(table, kBucketCount + 1);
+  index->mPostings = std::span(table + kBucketCount + 1,
+                               static_cast<size_t>(header.postingCount));
+  // find() slices postings with these, so they must stay inside the file.
+  if (index->mBuckets[0] != 0 ||
+      index->mBuckets[kBucketCount] != header.postingCount) {
+    return nullptr;
+  }
+  for (size_t i = 1; i <= kBucketCount; ++i) {
+    if (index->mBuckets[i] < index->mBuckets[i - 1]) return nullptr;
+  }
+  return index;
+}
+
+std::span<const uint32_t>
+GramIndex::find(std::span<const uint8_t, kGramSize> gram) const {
+  const uint32_t bucket = hashGram(gram.data());
+  return mPostings.subspan(mBuckets[bucket],
+                           mBuckets[bucket + 1] - mBuckets[bucket]);
+}
+
+} // namespace pl::memory
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "pl/memory/SuffixIndex.h"
+
+namespace pl::memory {
+
+// Inverted index of the 4-byte grams of some ranges: for every gram that
+// starts at a multiple of kGramStep, its offset from the base is listed under
+// a hash of its bytes. A bucket is sorted by offset and may hold other grams
+// that share the hash, so every position it yields still has to be verified.
+// The index is kept in one file that is mapped instead of read, so a large
+// module's index costs page cache rather than heap.
+class GramIndex {
+public:
+  static constexpr size_t kGramSize = 4;
+  static constexpr size_t kGramStep = 4;
+  static constexpr size_t kBucketBits = 20;
+  static constexpr size_t kBucketCount = size_t{1} << kBucketBits;
+
+  ~GramIndex();
+  GramIndex(const GramIndex &) = delete;
+  GramIndex &operator=(const GramIndex &) = delete;
+
+  // Indexes ranges, reading their bytes at the same offsets from image, and
+  // stores the index at path, then maps it from there. Passing a mapping of
+  // the module file as image keeps bytes patched in the loaded module out of
+  // an index that later launches reuse. The index stays on the heap when path
+  // is empty or cannot be written. Fails when a range ends too far from the
+  // base for 32-bit offsets.
+  static std::unique_ptr<GramIndex> build(uintptr_t base,
+                                          std::vector<IndexedRange> ranges,
+                                          uintptr_t image,
+                                          const std::filesystem::path &path);
+
+  // Maps the index stored for the same ranges, or returns nullptr when the
+  // file is missing or was stored for something else. Only the header and
+  // the bucket table are checked: offsets are trusted no further than any
+  // other candidate, which the caller verifies inside its own regions.
+  static std::unique_ptr<GramIndex> open(uintptr_t base,
+                                         std::vector<IndexedRange> ranges,
+                                         const std::filesystem::path &path);
+
+  // Offsets from the base of the grams hashed like gram, ascending.
+  [[nodiscard]] std::span<const uint32_t>
+  find(std::span<const uint8_t, kGramSize> gram) const;
+
+  [[nodiscard]] std::span<const IndexedRange> ranges() const noexcept {
+    return mRanges;
+  }
+  [[nodiscard]] uintptr_t base() const noexcept { return mBase; }
+  [[nodiscard]] size_t size() const noexcept { return mPostings.size(); }
+  [[nodiscard]] bool mapped() const noexcept { return mMapping != nullptr; }
+
+private:
+  GramIndex(uintptr_t base, std::vector<IndexedRange> ranges);
+
+  uintptr_t mBase;
+  std::vector<IndexedRange> mRanges;
+  std::vector<uint32_t> mStorage;
+  void *mMapping = nullptr;
+  size_t mMappingSize = 0;
+  std::span<const uint32_t> mBuckets;
+  std::span<const uint32_t> mPostings;
+};
+
+} // namespace pl::memory
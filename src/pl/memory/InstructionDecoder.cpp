@@ -0,0 +1,289 @@
+#include "pl/memory/InstructionDecoder.h"
+
+namespace pl::memory {
+namespace {
+
+// How many instructions after the first half of an address pair are searched
+// for the second half; compilers often schedule other work in between.
+constexpr size_t kMaxPairDistance = 4;
+
+int64_t signExtend(uint64_t value, unsigned bits) {
+  const uint64_t sign = uint64_t{1} << (bits - 1);
+  value &= (sign << 1) - 1;
+  return static_cast<int64_t>(value ^ sign) - static_cast<int64_t>(sign);
+}
+
+uintptr_t offsetBy(uintptr_t base, int64_t delta) {
+  return base + static_cast<uintptr_t>(delta);
+}
+
+bool readWord(const CodeReader &read, uintptr_t address, uint32_t &value) {
+  return read(address, &value, sizeof(value));
+}
+
+bool readHalf(const CodeReader &read, uintptr_t address, uint16_t &value) {
+  return read(address, &value, sizeof(value));
+}
+
+bool decodeA64Branch(uintptr_t address, const CodeReader &read,
+                     uintptr_t &target) {
+  uint32_t insn = 0;
+  if (!readWord(read, address, insn)) return false;
+
+  // B, BL
+  if ((insn & 0x7C000000) == 0x14000000) {
+    target = offsetBy(address, signExtend(insn, 26) * 4);
+    return true;
+  }
+  // B.cond, CBZ, CBNZ
+  if ((insn & 0xFF000010) == 0x54000000 ||
+      (insn & 0x7E000000) == 0x34000000) {
+    target = offsetBy(address, signExtend(insn >> 5, 19) * 4);
+    return true;
+  }
+  return false;
+}
+
+bool decodeA64PcRelative(uintptr_t address, const CodeReader &read,
+                         uintptr_t &target) {
+  uint32_t insn = 0;
+  if (!readWord(read, address, insn)) return false;
+
+  const uint64_t immediate =
+      (static_cast<uint64_t>(insn >> 5) & 0x7FFFF) << 2 | ((insn >> 29) & 3);
+  if ((insn & 0x9F000000) == 0x10000000) { // ADR
+    target = offsetBy(address, signExtend(immediate, 21));
+    return true;
+  }
+  if ((insn & 0x9F000000) != 0x90000000) return false; // ADRP
+
+  const uint32_t reg = insn & 0x1F;
+  const uintptr_t page =
+      offsetBy(address & ~uintptr_t{0xFFF}, signExtend(immediate, 21) * 4096);
+  for (size_t i = 1; i <= kMaxPairDistance; ++i) {
+    uint32_t next = 0;
+    if (!readWord(read, address + i * 4, next)) return false;
+
+    const uint64_t imm12 = (next >> 10) & 0xFFF;
+    if (((next >> 5) & 0x1F) == reg) {
+      // ADD (immediate), optionally shifted by 12
+      if ((next & 0x7F800000) == 0x11000000) {
+        const unsigned shift = (next >> 22 & 1) * 12;
+        target = page + static_cast<uintptr_t>(imm12 << shift);
+        return true;
+      }
+      // LDR/STR (unsigned immediate), scaled by the access size
+      if ((next & 0x3B000000) == 0x39000000) {
+        unsigned scale = next >> 30;
+        if ((next & 0x04800000) == 0x04800000) scale = 4; // 128-bit SIMD
+        target = page + static_cast<uintptr_t>(imm12 << scale);
+        return true;
+      }
+    }
+    if ((next & 0x1F) == reg) return false;
+  }
+  return false;
+}
+
+bool isThumb32(uint16_t halfword) { return (halfword >> 11) >= 0x1D; }
+
+uint32_t thumbMoveImmediate(uint16_t first, uint16_t second) {
+  return (first & 0xFu) << 12 | (first >> 10 & 1u) << 11 |
+         (second >> 12 & 7u) << 8 | (second & 0xFFu);
+}
+
+bool decodeThumbBranch(uintptr_t address, const CodeReader &read,
+                       uintptr_t &target) {
+  uint16_t first = 0;
+  if (!readHalf(read, address, first)) return false;
+
+  const uintptr_t pc = address + 4;
+  if ((first & 0xF800) == 0xE000) { // B (T2)
+    target = offsetBy(pc, signExtend(first, 11) * 2);
+    return true;
+  }
+  if ((first & 0xF000) == 0xD000 && (first & 0x0E00) != 0x0E00) { // B<c>
+    target = offsetBy(pc, signExtend(first, 8) * 2);
+    return true;
+  }
+  if ((first & 0xF800) != 0xF000) return false;
+
+  uint16_t second = 0;
+  if (!readHalf(read, address + 2, second)) return false;
+
+  const uint32_t sign = first >> 10 & 1u;
+  const uint32_t i1 = ~((second >> 13) ^ sign) & 1u;
+  const uint32_t i2 = ~((second >> 11) ^ sign) & 1u;
+  const uint32_t immediate = sign << 24 | i1 << 23 | i2 << 22 |
+                             (first & 0x3FFu) << 12 | (second & 0x7FFu) << 1;
+  // BL, B.W (T4)
+  if ((second & 0xD000) == 0xD000 || (second & 0xD000) == 0x9000) {
+    target = offsetBy(pc, signExtend(immediate, 25));
+    return true;
+  }
+  // BLX switches to ARM state; the target is word aligned.
+  if ((second & 0xD001) == 0xC000) {
+    target = offsetBy(pc & ~uintptr_t{3}, signExtend(immediate, 25));
+    return true;
+  }
+  return false;
+}
+
+bool decodeThumbPcRelative(uintptr_t address, const CodeReader &read,
+                           uintptr_t &target) {
+  uint16_t first = 0;
+  if (!readHalf(read, address, first)) return false;
+
+  const uintptr_t literalBase = (address + 4) & ~uintptr_t{3};
+  if ((first & 0xF800) == 0xA000) { // ADR (T1)
+    target = literalBase + (first & 0xFFu) * 4;
+    return true;
+  }
+
+  uint32_t reg = 0;
+  uint32_t value = 0;
+  uintptr_t cursor = address;
+  if ((first & 0xF800) == 0x4800) { // LDR Rt, [PC, #imm8]
+    reg = first >> 8 & 7u;
+    if (!readWord(read, literalBase + (first & 0xFFu) * 4, value)) {
+      return false;
+    }
+    cursor += 2;
+  } else {
+    uint16_t second = 0;
+    if (!readHalf(read, address + 2, second)) return false;
+    if ((first & 0xFF7F) == 0xF85F) { // LDR.W Rt, [PC, #+/-imm12]
+      reg = second >> 12;
+      const uintptr_t offset = second & 0xFFFu;
+      const uintptr_t literal =
+          (first & 0x80) ? literalBase + offset : literalBase - offset;
+      if (!readWord(read, literal, value)) return false;
+      cursor += 4;
+    } else if ((first & 0xFBF0) == 0xF240) { // MOVW
+      reg = second >> 8 & 0xFu;
+      value = thumbMoveImmediate(first, second);
+      cursor += 4;
+
+      uint16_t high[2] = {};
+      if (read(cursor, high, sizeof(high)) && (high[0] & 0xFBF0) == 0xF2C0 &&
+          (high[1] >> 8 & 0xFu) == reg) { // MOVT
+        value |= thumbMoveImmediate(high[0], high[1]) << 16;
+        cursor += 4;
+      }
+    } else {
+      return false;
+    }
+  }
+
+  for (size_t i = 0; i < kMaxPairDistance; ++i) {
+    uint16_t next = 0;
+    if (!readHalf(read, cursor, next)) return false;
+    // ADD Rdn, PC
+    const uint32_t addReg = (next & 7u) | (next >> 4 & 8u);
+    if ((next & 0xFF78) == 0x4478 && addReg == reg) {
+      target = cursor + 4 + value;
+      return true;
+    }
+    cursor += isThumb32(next) ? 4 : 2;
+  }
+  return false;
+}
+
+bool decodeA64StableBits(uintptr_t address, const CodeReader &read,
+                         size_t &size, uint32_t &mask, int &pageRegister) {
+  uint32_t insn = 0;
+  if (!readWord(read, address, insn)) return false;
+
+  size = 4;
+  mask = 0xFFFFFFFF;
+  const int baseRegister = static_cast<int>(insn >> 5 & 0x1F);
+  if ((insn & 0x7C000000) == 0x14000000) { // B, BL
+    mask = 0xFC000000;
+  } else if ((insn & 0xFF000010) == 0x54000000 ||  // B.cond
+             (insn & 0x7E000000) == 0x34000000 ||  // CBZ, CBNZ
+             (insn & 0x3B000000) == 0x18000000) {  // LDR (literal)
+    mask = ~(0x7FFFFu << 5);
+  } else if ((insn & 0x7E000000) == 0x36000000) { // TBZ, TBNZ
+    mask = ~(0x3FFFu << 5);
+  } else if ((insn & 0x1F000000) == 0x10000000) { // ADR, ADRP
+    mask = ~(3u << 29 | 0x7FFFFu << 5);
+    if (insn >> 31) pageRegister = static_cast<int>(insn & 0x1F);
+  } else if (baseRegister == pageRegister &&
+             ((insn & 0x7F800000) == 0x11000000 ||  // ADD (immediate)
+              (insn & 0x3B000000) == 0x39000000)) { // LDR/STR (unsigned)
+    mask = ~(0xFFFu << 10);
+  }
+  return true;
+}
+
+bool decodeThumbStableBits(uintptr_t address, const CodeReader &read,
+                           size_t &size, uint32_t &mask) {
+  uint16_t first = 0;
+  if (!readHalf(read, address, first)) return false;
+
+  if (!isThumb32(first)) {
+    size = 2;
+    mask = 0xFFFF;
+    if ((first & 0xF800) == 0xE000) { // B (T2)
+      mask = 0xF800;
+    } else if (((first & 0xF000) == 0xD000 &&
+                (first & 0x0E00) != 0x0E00) || // B<c>
+               (first & 0xF800) == 0xA000 ||   // ADR
+               (first & 0xF800) == 0x4800) {   // LDR Rt, [PC, #imm8]
+      mask = 0xFF00;
+    } else if ((first & 0xF500) == 0xB100) { // CBZ, CBNZ
+      mask = 0xFD07;
+    }
+    return true;
+  }
+
+  uint16_t second = 0;
+  if (!readHalf(read, address + 2, second)) return false;
+  size = 4;
+  uint32_t firstMask = 0xFFFF;
+  uint32_t secondMask = 0xFFFF;
+  if ((first & 0xF800) == 0xF000 &&
+      ((second & 0xD000) == 0xD000 || (second & 0xD000) == 0x9000 ||
+       (second & 0xD001) == 0xC000)) { // BL, B.W (T4), BLX
+    firstMask = 0xF800;
+    secondMask = 0xD000;
+  } else if ((first & 0xF800) == 0xF000 && (second & 0xD000) == 0x8000 &&
+             (first & 0x0380) != 0x0380) { // B<c>.W
+    firstMask = 0xFBC0;
+    secondMask = 0xD000;
+  } else if ((first & 0xFF7F) == 0xF85F) { // LDR.W Rt, [PC, #+/-imm12]
+    firstMask = 0xFF7F;
+    secondMask = 0xF000;
+  } else if ((first & 0xFB70) == 0xF240) { // MOVW, MOVT
+    firstMask = 0xFBF0;
+    secondMask = 0x8F00;
+  }
+  mask = secondMask << 16 | firstMask;
+  return true;
+}
+
+} // namespace
+
+bool decodeStableBits(InstructionSet set, uintptr_t address,
+                      const CodeReader &read, size_t &size, uint32_t &mask,
+                      int &pageRegister) {
+  return set == InstructionSet::A64
+             ? decodeA64StableBits(address, read, size, mask, pageRegister)
+             : decodeThumbStableBits(address, read, size, mask);
+}
+
+bool decodeBranchTarget(InstructionSet set, uintptr_t address,
+                        const CodeReader &read, uintptr_t &target) {
+  return set == InstructionSet::A64
+             ? decodeA64Branch(address, read, target)
+             : decodeThumbBranch(address, read, target);
+}
+
+bool decodePcRelativeTarget(InstructionSet set, uintptr_t address,
+                            const CodeReader &read, uintptr_t &target) {
+  return set == InstructionSet::A64
+             ? decodeA64PcRelative(address, read, target)
+             : decodeThumbPcRelative(address, read, target);
+}
+
+} // namespace pl::memory
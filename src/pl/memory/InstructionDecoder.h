@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace pl::memory {
+
+enum class InstructionSet { A64, Thumb };
+
+#if defined(__arm__)
+inline constexpr InstructionSet kNativeInstructionSet = InstructionSet::Thumb;
+#else
+inline constexpr InstructionSet kNativeInstructionSet = InstructionSet::A64;
+#endif
+
+// Copies size bytes at address into out, or returns false if the range is not
+// safe to read.
+using CodeReader =
+    std::function<bool(uintptr_t address, void *out, size_t size)>;
+
+// Target of the B/BL (and B.cond on A64, BLX/B.W/B on Thumb) at address.
+bool decodeBranchTarget(InstructionSet set, uintptr_t address,
+                        const CodeReader &read, uintptr_t &target);
+
+// Address built by the PC-relative sequence starting at address: ADR, or
+// ADRP followed by ADD/LDR on A64; MOVW[/MOVT] or LDR literal followed by
+// ADD Rd, PC on Thumb.
+bool decodePcRelativeTarget(InstructionSet set, uintptr_t address,
+                            const CodeReader &read, uintptr_t &target);
+
+// Bits of the instruction at address that stay the same wherever the code and
+// its data end up: branch and literal offsets are cleared, as are ADR/ADRP
+// pages and the page offsets added to an ADRP register on A64, and MOVW/MOVT
+// immediates on Thumb. Bytes are in memory order, so a Thumb 32-bit
+// instruction keeps its first halfword in the low half of mask. size receives
+// the instruction length; pageRegister carries the register of the last ADRP
+// from one call to the next and starts at -1.
+bool decodeStableBits(InstructionSet set, uintptr_t address,
+                      const CodeReader &read, size_t &size, uint32_t &mask,
+                      int &pageRegister);
+
+} // namespace pl::memory
@@ -0,0 +1,306 @@
+#include "pl/memory/ModuleFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <link.h>
+#include <memory>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+namespace pl::memory {
+namespace {
+
+#if defined(__LP64__)
+constexpr unsigned char kNativeElfClass = ELFCLASS64;
+#else
+constexpr unsigned char kNativeElfClass = ELFCLASS32;
+#endif
+
+uintptr_t pageSize() {
+  static const auto size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+bool readAt(int fd, uint64_t offset, void *out, size_t size) {
+  auto *bytes = static_cast<char *>(out);
+  while (size != 0) {
+    const ssize_t read = pread(fd, bytes, size, static_cast<off_t>(offset));
+    if (read < 0 && errno == EINTR) continue;
+    if (read <= 0) return false;
+    bytes += read;
+    offset += static_cast<uint64_t>(read);
+    size -= static_cast<size_t>(read);
+  }
+  return true;
+}
+
+template <typename T>
+bool readTable(int fd, uint64_t offset, size_t count, size_t entrySize,
+               std::vector<T> &out) {
+  if (entrySize != sizeof(T)) return false;
+  out.resize(count);
+  return readAt(fd, offset, out.data(), count * sizeof(T));
+}
+
+class FileDescriptor {
+public:
+  explicit FileDescriptor(int fd) : mFd(fd) {}
+  ~FileDescriptor() {
+    if (mFd >= 0) close(mFd);
+  }
+  FileDescriptor(const FileDescriptor &) = delete;
+  FileDescriptor &operator=(const FileDescriptor &) = delete;
+
+  [[nodiscard]] int get() const noexcept { return mFd; }
+
+private:
+  int mFd = -1;
+};
+
+std::string readFileBuildId(int fd, const std::vector<ElfW(Phdr)> &phdrs) {
+  for (const auto &phdr : phdrs) {
+    if (phdr.p_type != PT_NOTE || phdr.p_filesz == 0 ||
+        phdr.p_filesz > (1u << 16)) {
+      continue;
+    }
+    std::vector<uint8_t> notes(phdr.p_filesz);
+    if (!readAt(fd, phdr.p_offset, notes.data(), notes.size())) continue;
+    auto buildId = readBuildIdNote(notes.data(), notes.size());
+    if (!buildId.empty()) return buildId;
+  }
+  return {};
+}
+
+// Allocated sections with file contents; a file without section headers
+// simply has none.
+std::vector<MappedModuleFile::Section>
+readSections(int fd, const ElfW(Ehdr) &header, uintptr_t base) {
+  std::vector<ElfW(Shdr)> shdrs;
+  if (header.e_shnum == 0 || header.e_shstrndx >= header.e_shnum ||
+      !readTable(fd, header.e_shoff, header.e_shnum, header.e_shentsize,
+                 shdrs)) {
+    return {};
+  }
+
+  const auto &names = shdrs[header.e_shstrndx];
+  std::string strings(names.sh_size, '\0');
+  if (!readAt(fd, names.sh_offset, strings.data(), strings.size())) return {};
+
+  std::vector<MappedModuleFile::Section> sections;
+  for (const auto &shdr : shdrs) {
+    if ((shdr.sh_flags & SHF_ALLOC) == 0 || shdr.sh_type == SHT_NOBITS ||
+        shdr.sh_name >= strings.size()) {
+      continue;
+    }
+    sections.push_back(MappedModuleFile::Section{
+        strings.c_str() + shdr.sh_name, base + shdr.sh_addr, shdr.sh_size});
+  }
+  return sections;
+}
+
+// Defined symbols of a file's .symtab, read once per build of the file.
+// Names point into strings, whose elements never move.
+struct FileSymbolTable {
+  struct Symbol {
+    uintptr_t value = 0;
+    bool global = false;
+  };
+  std::deque<std::string> strings;
+  std::unordered_map<std::string_view, Symbol> values;
+};
+
+std::mutex fileSymbolMutex;
+std::unordered_map<std::string, std::shared_ptr<const FileSymbolTable>>
+    fileSymbolTables;
+
+// Global definitions win over local ones; a file without .symtab, or one
+// that cannot be read, yields an empty table.
+std::shared_ptr<const FileSymbolTable>
+readSymbolTable(const std::string &path) {
+  auto table = std::make_shared<FileSymbolTable>();
+  const FileDescriptor file(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+  ElfW(Ehdr) header{};
+  std::vector<ElfW(Shdr)> shdrs;
+  if (file.get() < 0 || !readAt(file.get(), 0, &header, sizeof(header)) ||
+      std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 ||
+      header.e_ident[EI_CLASS] != kNativeElfClass ||
+      !readTable(file.get(), header.e_shoff, header.e_shnum,
+                 header.e_shentsize, shdrs)) {
+    return table;
+  }
+
+  for (const auto &shdr : shdrs) {
+    if (shdr.sh_type != SHT_SYMTAB || shdr.sh_link >= shdrs.size()) continue;
+
+    const auto &strtab = shdrs[shdr.sh_link];
+    std::string strings(strtab.sh_size, '\0');
+    std::vector<ElfW(Sym)> symbols;
+    if (!readAt(file.get(), strtab.sh_offset, strings.data(), strings.size()) ||
+        shdr.sh_entsize == 0 ||
+        !readTable(file.get(), shdr.sh_offset, shdr.sh_size / shdr.sh_entsize,
+                   shdr.sh_entsize, symbols)) {
+      continue;
+    }
+
+    const auto &names = table->strings.emplace_back(std::move(strings));
+    for (const auto &symbol : symbols) {
+      const auto type = symbol.st_info & 0xf;
+      if (symbol.st_shndx == SHN_UNDEF || symbol.st_value == 0 ||
+          symbol.st_name >= names.size() || type == STT_TLS ||
+          type == STT_GNU_IFUNC || type == STT_SECTION || type == STT_FILE) {
+        continue;
+      }
+      const bool global = (symbol.st_info >> 4) != STB_LOCAL;
+      const auto [it, inserted] = table->values.try_emplace(
+          std::string_view(names.c_str() + symbol.st_name),
+          FileSymbolTable::Symbol{symbol.st_value, global});
+      if (!inserted && global && !it->second.global) {
+        it->second = FileSymbolTable::Symbol{symbol.st_value, true};
+      }
+    }
+  }
+  return table;
+}
+
+} // namespace
+
+MappedModuleFile::MappedModuleFile(const std::string &path) {
+  const FileDescriptor file(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+  struct stat status {};
+  ElfW(Ehdr) header{};
+  if (file.get() < 0 || fstat(file.get(), &status) != 0 ||
+      !readAt(file.get(), 0, &header, sizeof(header)) ||
+      std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 ||
+      header.e_ident[EI_CLASS] != kNativeElfClass) {
+    return;
+  }
+
+  std::vector<ElfW(Phdr)> phdrs;
+  if (!readTable(file.get(), header.e_phoff, header.e_phnum,
+                 header.e_phentsize, phdrs)) {
+    return;
+  }
+
+  const uintptr_t mask = ~(pageSize() - 1);
+  uintptr_t minVaddr = UINTPTR_MAX;
+  uintptr_t maxVaddr = 0;
+  for (const auto &phdr : phdrs) {
+    if (phdr.p_type != PT_LOAD || phdr.p_memsz == 0) continue;
+    minVaddr = std::min<uintptr_t>(minVaddr, phdr.p_vaddr & mask);
+    maxVaddr = std::max<uintptr_t>(
+        maxVaddr, (phdr.p_vaddr + phdr.p_memsz + pageSize() - 1) & mask);
+  }
+  if (minVaddr >= maxVaddr) return;
+
+  // One reservation keeps the segments at their relative addresses, so
+  // branch and PC-relative targets decode the same as in the loaded image.
+  mReservationSize = maxVaddr - minVaddr;
+  void *reservation = mmap(nullptr, mReservationSize, PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (reservation == MAP_FAILED) return;
+  mReservation = reservation;
+  const uintptr_t base = reinterpret_cast<uintptr_t>(reservation) - minVaddr;
+
+  const auto fileSize = static_cast<uint64_t>(status.st_size);
+  for (const auto &phdr : phdrs) {
+    if (phdr.p_type != PT_LOAD || phdr.p_filesz == 0) continue;
+    if (phdr.p_offset > fileSize || phdr.p_filesz > fileSize - phdr.p_offset ||
+        phdr.p_filesz > phdr.p_memsz ||
+        (phdr.p_vaddr - phdr.p_offset) % pageSize() != 0) {
+      munmap(mReservation, mReservationSize);
+      mReservation = nullptr;
+      return;
+    }
+
+    const uintptr_t start = (base + phdr.p_vaddr) & mask;
+    const uintptr_t end = base + phdr.p_vaddr + phdr.p_filesz;
+    if (mmap(reinterpret_cast<void *>(start), end - start, PROT_READ,
+             MAP_PRIVATE | MAP_FIXED, file.get(),
+             static_cast<off_t>(phdr.p_offset & mask)) == MAP_FAILED) {
+      munmap(mReservation, mReservationSize);
+      mReservation = nullptr;
+      return;
+    }
+
+    // Ends at the file contents rather than a page boundary: the rest of the
+    // last page holds unrelated file bytes where the loader has zeroes.
+    ModuleSegment segment;
+    segment.start = start;
+    segment.end = end;
+    segment.readable = (phdr.p_flags & PF_R) != 0;
+    segment.writable = (phdr.p_flags & PF_W) != 0;
+    segment.executable = (phdr.p_flags & PF_X) != 0;
+    if (!mImage.segments.empty()) {
+      segment.start = std::max(segment.start, mImage.segments.back().end);
+    }
+    if (segment.start < segment.end) mImage.segments.push_back(segment);
+  }
+
+  for (const auto &phdr : phdrs) {
+    if (phdr.p_type == PT_DYNAMIC) mImage.dynamic = base + phdr.p_vaddr;
+  }
+  mImage.path = path;
+  mImage.base = base;
+  mImage.buildId = readFileBuildId(file.get(), phdrs);
+  mSections = readSections(file.get(), header, base);
+}
+
+MappedModuleFile::~MappedModuleFile() {
+  if (mReservation) munmap(mReservation, mReservationSize);
+}
+
+void readFileSymbols(const std::string &path, std::string_view buildId,
+                     std::span<const std::string_view> names,
+                     std::span<uintptr_t> values) {
+  if (std::ranges::find(values, uintptr_t{0}) == values.end()) return;
+
+  // Without a build-id the file's identity has to stand in for it.
+  std::string key = path + '\n';
+  if (!buildId.empty()) {
+    key += buildId;
+  } else {
+    struct stat status {};
+    if (stat(path.c_str(), &status) != 0) return;
+    key += std::to_string(status.st_ino) + ':' +
+           std::to_string(status.st_size) + ':' +
+           std::to_string(status.st_mtim.tv_sec) + '.' +
+           std::to_string(status.st_mtim.tv_nsec);
+  }
+
+  std::shared_ptr<const FileSymbolTable> table;
+  {
+    std::lock_guard lock(fileSymbolMutex);
+    const auto it = fileSymbolTables.find(key);
+    if (it != fileSymbolTables.end()) table = it->second;
+  }
+  if (!table) {
+    table = readSymbolTable(path);
+    std::lock_guard lock(fileSymbolMutex);
+    table = fileSymbolTables.try_emplace(std::move(key), table).first->second;
+  }
+
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (values[i] != 0) continue;
+    const auto it = table->values.find(names[i]);
+    if (it != table->values.end()) values[i] = it->second.value;
+  }
+}
+
+uintptr_t MappedModuleFile::findSection(std::string_view name,
+                                        size_t &size) const {
+  for (const auto &section : mSections) {
+    if (section.name != name) continue;
+    size = section.size;
+    return section.start;
+  }
+  return 0;
+}
+
+} // namespace pl::memory
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pl/memory/ModuleMap.h"
+
+namespace pl::memory {
+
+// A module file mapped read-only in the layout the loader would give it, so
+// offsets from image().base match those of the loaded module. Nothing is
+// relocated and only the file-backed part of each PT_LOAD segment is mapped.
+class MappedModuleFile {
+public:
+  explicit MappedModuleFile(const std::string &path);
+  ~MappedModuleFile();
+  MappedModuleFile(const MappedModuleFile &) = delete;
+  MappedModuleFile &operator=(const MappedModuleFile &) = delete;
+
+  [[nodiscard]] bool valid() const noexcept { return mReservation != nullptr; }
+  [[nodiscard]] const LoadedModule &image() const noexcept { return mImage; }
+
+  // Start of an allocated section inside the mapping, or 0 with size left
+  // untouched when the file has no such section.
+  [[nodiscard]] uintptr_t findSection(std::string_view name,
+                                      size_t &size) const;
+
+  struct Section {
+    std::string name;
+    uintptr_t start = 0;
+    size_t size = 0;
+  };
+
+private:
+  LoadedModule mImage;
+  std::vector<Section> mSections;
+  void *mReservation = nullptr;
+  size_t mReservationSize = 0;
+};
+
+// Fills each zero entry of values with the st_value of the defined symbol of
+// that name in the .symtab of the ELF file at path. Global definitions win
+// over local ones; files without .symtab leave values untouched. The table is
+// parsed once per path and build-id, or per file identity without one.
+void readFileSymbols(const std::string &path, std::string_view buildId,
+                     std::span<const std::string_view> names,
+                     std::span<uintptr_t> values);
+
+} // namespace pl::memory
@@ -0,0 +1,233 @@
+#include "pl/memory/ModuleMap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <link.h>
+#include <mutex>
+#include <shared_mutex>
+#include <time.h>
+#include <unistd.h>
+
+namespace pl::memory {
+namespace {
+
+std::shared_mutex moduleMapMutex;
+std::shared_ptr<const ModuleMap> currentModuleMap;
+std::atomic<uint64_t> recentGeneration{0};
+std::atomic<int64_t> lastGenerationCheck{INT64_MIN / 2};
+
+// The coarse clock is read from the vDSO without a syscall; its few
+// milliseconds of resolution are fine for a recheck interval.
+int64_t coarseNow() {
+  timespec now{};
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+  return int64_t{now.tv_sec} * 1'000'000'000 + now.tv_nsec;
+}
+
+std::string_view fileName(std::string_view path) {
+  const size_t slash = path.rfind('/');
+  return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+uintptr_t pageSize() {
+  static const auto size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+std::string toHex(const uint8_t *data, size_t size) {
+  static constexpr char kDigits[] = "0123456789abcdef";
+  std::string hex;
+  hex.reserve(size * 2);
+  for (size_t i = 0; i < size; ++i) {
+    hex.push_back(kDigits[data[i] >> 4]);
+    hex.push_back(kDigits[data[i] & 0xF]);
+  }
+  return hex;
+}
+
+std::string readBuildId(const dl_phdr_info &info) {
+  for (ElfW(Half) i = 0; i < info.dlpi_phnum; ++i) {
+    const auto &phdr = info.dlpi_phdr[i];
+    if (phdr.p_type != PT_NOTE) continue;
+
+    auto buildId = readBuildIdNote(
+        reinterpret_cast<const uint8_t *>(info.dlpi_addr + phdr.p_vaddr),
+        phdr.p_memsz);
+    if (!buildId.empty()) return buildId;
+  }
+  return {};
+}
+
+int collectModule(dl_phdr_info *info, size_t, void *data) {
+  auto &modules = *static_cast<std::vector<LoadedModule> *>(data);
+  LoadedModule module;
+  module.path = info->dlpi_name ? info->dlpi_name : "";
+  module.base = info->dlpi_addr;
+
+  const uintptr_t mask = ~(pageSize() - 1);
+  for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+    const auto &phdr = info->dlpi_phdr[i];
+    if (phdr.p_type == PT_DYNAMIC) {
+      module.dynamic = info->dlpi_addr + phdr.p_vaddr;
+    }
+    if (phdr.p_type != PT_LOAD || phdr.p_memsz == 0) continue;
+
+    ModuleSegment segment;
+    segment.start = (info->dlpi_addr + phdr.p_vaddr) & mask;
+    segment.end = (info->dlpi_addr + phdr.p_vaddr + phdr.p_memsz +
+                   pageSize() - 1) & mask;
+    segment.readable = (phdr.p_flags & PF_R) != 0;
+    segment.writable = (phdr.p_flags & PF_W) != 0;
+    segment.executable = (phdr.p_flags & PF_X) != 0;
+    if (!module.segments.empty()) {
+      segment.start = std::max(segment.start, module.segments.back().end);
+    }
+    if (segment.start < segment.end) module.segments.push_back(segment);
+  }
+  if (module.segments.empty()) return 0;
+
+  module.buildId = readBuildId(*info);
+  modules.push_back(std::move(module));
+  return 0;
+}
+
+// The loader counts every image it has added and removed; older loaders
+// without those fields get a fingerprint of the loaded bases instead.
+int readLoaderCounters(dl_phdr_info *info, size_t size, void *data) {
+  auto &generation = *static_cast<uint64_t *>(data);
+  if (size >= offsetof(dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs)) {
+    generation = info->dlpi_adds + info->dlpi_subs;
+    return 1;
+  }
+  generation = (generation ^ info->dlpi_addr) * 0x100000001b3ull + 1;
+  return 0;
+}
+
+} // namespace
+
+ModuleMap::ModuleMap(uint64_t generation, std::vector<LoadedModule> modules)
+    : mGeneration(generation), mModules(std::move(modules)) {
+  mByFileName.resize(mModules.size());
+  for (size_t i = 0; i < mModules.size(); ++i) {
+    mByFileName[i] = i;
+    for (const auto &segment : mModules[i].segments) {
+      if (segment.readable) {
+        mReadable.push_back(Range{segment.start, segment.end, i});
+      }
+    }
+  }
+  std::sort(mByFileName.begin(), mByFileName.end(),
+            [this](size_t left, size_t right) {
+              return fileName(mModules[left].path) <
+                     fileName(mModules[right].path);
+            });
+  std::sort(mReadable.begin(), mReadable.end(),
+            [](const Range &left, const Range &right) {
+              return left.start < right.start;
+            });
+}
+
+const LoadedModule *ModuleMap::findModule(std::string_view name) const {
+  if (name.empty()) return nullptr;
+
+  const auto it = std::lower_bound(
+      mByFileName.begin(), mByFileName.end(), name,
+      [this](size_t index, std::string_view value) {
+        return fileName(mModules[index].path) < value;
+      });
+  if (it != mByFileName.end() && fileName(mModules[*it].path) == name) {
+    return &mModules[*it];
+  }
+
+  for (const auto &module : mModules) {
+    if (module.path.find(name) != std::string::npos) return &module;
+  }
+  return nullptr;
+}
+
+const LoadedModule *ModuleMap::findModuleAt(uintptr_t address) const {
+  const auto it = std::upper_bound(
+      mReadable.begin(), mReadable.end(), address,
+      [](uintptr_t value, const Range &range) { return value < range.start; });
+  if (it == mReadable.begin()) return nullptr;
+  const auto &range = *std::prev(it);
+  return address < range.end ? &mModules[range.module] : nullptr;
+}
+
+bool ModuleMap::isReadable(uintptr_t address, size_t size) const {
+  if (size == 0 || size > UINTPTR_MAX - address) return false;
+  const uintptr_t end = address + size;
+
+  auto it = std::upper_bound(
+      mReadable.begin(), mReadable.end(), address,
+      [](uintptr_t value, const Range &range) { return value < range.start; });
+  if (it == mReadable.begin()) return false;
+  --it;
+  uintptr_t covered = address;
+  for (; it != mReadable.end() && it->start <= covered; ++it) {
+    covered = std::max(covered, it->end);
+    if (covered >= end) return true;
+  }
+  return false;
+}
+
+std::string readBuildIdNote(const uint8_t *notes, size_t size) {
+  const auto *note = notes;
+  const auto *noteEnd = notes + size;
+  while (note + sizeof(ElfW(Nhdr)) <= noteEnd) {
+    ElfW(Nhdr) header{};
+    std::memcpy(&header, note, sizeof(header));
+    const size_t nameSize = (header.n_namesz + 3) & ~size_t{3};
+    const size_t descSize = (header.n_descsz + 3) & ~size_t{3};
+    const auto *name = note + sizeof(header);
+    const auto *desc = name + nameSize;
+    if (desc + descSize > noteEnd) break;
+    if (header.n_type == NT_GNU_BUILD_ID && header.n_namesz == 4 &&
+        std::memcmp(name, "GNU", 4) == 0 && header.n_descsz != 0) {
+      return toHex(desc, header.n_descsz);
+    }
+    note = desc + descSize;
+  }
+  return {};
+}
+
+uint64_t getModuleMapGeneration() {
+  uint64_t generation = 0;
+  dl_iterate_phdr(readLoaderCounters, &generation);
+  return generation;
+}
+
+std::shared_ptr<const ModuleMap> getModuleMap() {
+  const int64_t checked = coarseNow();
+  const uint64_t generation = getModuleMapGeneration();
+  recentGeneration.store(generation, std::memory_order_release);
+  lastGenerationCheck.store(checked, std::memory_order_release);
+  {
+    std::shared_lock lock(moduleMapMutex);
+    if (currentModuleMap && currentModuleMap->generation() == generation) {
+      return currentModuleMap;
+    }
+  }
+
+  // Images loaded after the generation was read only make this snapshot
+  // newer than its tag, so the next call rebuilds it again at worst.
+  std::vector<LoadedModule> modules;
+  dl_iterate_phdr(collectModule, &modules);
+  auto map = std::make_shared<const ModuleMap>(generation, std::move(modules));
+
+  std::unique_lock lock(moduleMapMutex);
+  currentModuleMap = map;
+  return map;
+}
+
+uint64_t getRecentModuleMapGeneration() {
+  if (coarseNow() - lastGenerationCheck.load(std::memory_order_relaxed) <
+      kModuleMapRecheckNs) {
+    return recentGeneration.load(std::memory_order_acquire);
+  }
+  return getModuleMap()->generation();
+}
+
+} // namespace pl::memory
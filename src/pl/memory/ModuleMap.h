@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pl::memory {
+
+// One PT_LOAD segment of a loaded image, rounded out to whole pages.
+struct ModuleSegment {
+  uintptr_t start = 0;
+  uintptr_t end = 0;
+  bool readable = false;
+  bool writable = false;
+  bool executable = false;
+};
+
+struct LoadedModule {
+  std::string path;
+  uintptr_t base = 0;
+  uintptr_t dynamic = 0; // PT_DYNAMIC, 0 when the image has none.
+  std::string buildId;
+  std::vector<ModuleSegment> segments;
+};
+
+// Immutable snapshot of every image the dynamic loader has mapped, built from
+// dl_iterate_phdr and the images' program headers.
+class ModuleMap {
+public:
+  ModuleMap(uint64_t generation, std::vector<LoadedModule> modules);
+
+  [[nodiscard]] uint64_t generation() const noexcept { return mGeneration; }
+  [[nodiscard]] const std::vector<LoadedModule> &modules() const noexcept {
+    return mModules;
+  }
+
+  // Matches the file name exactly, then falls back to a substring of the
+  // path the way /proc/self/maps lookups used to.
+  [[nodiscard]] const LoadedModule *findModule(std::string_view name) const;
+  [[nodiscard]] const LoadedModule *findModuleAt(uintptr_t address) const;
+  [[nodiscard]] bool isReadable(uintptr_t address, size_t size) const;
+
+private:
+  struct Range {
+    uintptr_t start = 0;
+    uintptr_t end = 0;
+    size_t module = 0;
+  };
+
+  uint64_t mGeneration = 0;
+  std::vector<LoadedModule> mModules;
+  std::vector<size_t> mByFileName;
+  std::vector<Range> mReadable;
+};
+
+// Hex GNU build-id found in the contents of one PT_NOTE segment, or "".
+std::string readBuildIdNote(const uint8_t *notes, size_t size);
+
+// Changes whenever the loader maps or unmaps an image.
+uint64_t getModuleMapGeneration();
+
+// Current snapshot; rebuilt only when the generation has moved.
+std::shared_ptr<const ModuleMap> getModuleMap();
+
+// Generation of the last snapshot, without asking the loader as long as it
+// was read less than kModuleMapRecheckNs ago. Reading it takes the loader
+// lock, and older loaders walk every image for it, so hot paths that only
+// have to notice an unload eventually use this one.
+inline constexpr int64_t kModuleMapRecheckNs = 5'000'000;
+uint64_t getRecentModuleMapGeneration();
+
+} // namespace pl::memory
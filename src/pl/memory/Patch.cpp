@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cerrno>
 #include <cinttypes>
 #include <cstdio>
 #include <cstdlib>
@@ -11,10 +12,13 @@
 #include <string>
 #include <string_view>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <unordered_map>
 #include <unistd.h>
 #include <vector>
 
+#include "pl/memory/ModuleMap.h"
+
 namespace {
     struct PatchInfo {
         uintptr_t address;
@@ -45,11 +49,7 @@ namespace {
         return true;
     }
 
-    static bool hasReadableMappedRange(uintptr_t address, size_t length) {
-        uintptr_t end = 0;
-        if (!checkedAddressRange(address, length, end))
-            return false;
-
+    static bool hasReadableMapsRange(uintptr_t address, uintptr_t end) {
         FILE *maps = std::fopen("/proc/self/maps", "r");
         if (!maps)
             return false;
@@ -81,6 +81,46 @@ namespace {
         return false;
     }
 
+    // Loaded images are answered from the module map the signature
+    // resolver shares, in O(log n). Patches only ever widen protection, so
+    // a page the map calls readable stays readable after one. Anything
+    // else, such as heap or JIT memory or a segment loaded without read
+    // access, is asked of the kernel: process_vm_readv on this process
+    // copies one byte of every page and stops short at the first one that
+    // is unmapped or unreadable, where a memcpy would fault.
+    // /proc/self/maps is the fallback where the call is unavailable or
+    // filtered.
+    static bool hasReadableMappedRange(uintptr_t address, size_t length) {
+        uintptr_t end = 0;
+        if (!checkedAddressRange(address, length, end))
+            return false;
+        if (pl::memory::getModuleMap()->isReadable(address, length))
+            return true;
+
+        constexpr size_t kPagesPerCall = 64;
+        uint8_t sink[kPagesPerCall];
+        iovec local[kPagesPerCall];
+        iovec remote[kPagesPerCall];
+        uintptr_t page = address;
+        while (page < end) {
+            size_t count = 0;
+            for (; count < kPagesPerCall && page < end; ++count) {
+                local[count] = iovec{&sink[count], 1};
+                remote[count] = iovec{reinterpret_cast<void *>(page), 1};
+                page = getPageStart(page) + getPageSize();
+                if (page < getPageSize())
+                    page = end;
+            }
+            const ssize_t read =
+                process_vm_readv(getpid(), local, count, remote, count, 0);
+            if (read < 0 && (errno == ENOSYS || errno == EPERM))
+                return hasReadableMapsRange(address, end);
+            if (read != static_cast<ssize_t>(count))
+                return false;
+        }
+        return true;
+    }
+
     static bool setMemRWX(uintptr_t address, size_t length) {
         uintptr_t end = 0;
         if (!checkedAddressRange(address, length, end))
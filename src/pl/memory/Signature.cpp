@@ -2,38 +2,72 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <cctype>
+#include <chrono>
 #include <cinttypes>
+#include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <dlfcn.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <span>
 #include <shared_mutex>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "pl/Gloss.h"
 #include "pl/Logger.hpp"
+#include "pl/memory/ElfSymbols.h"
+#include "pl/memory/GramIndex.h"
+#include "pl/memory/InstructionDecoder.h"
+#include "pl/memory/ModuleFile.h"
+#include "pl/memory/ModuleMap.h"
+#include "pl/memory/SignatureScanner.h"
+#include "pl/memory/SuffixIndex.h"
 
 namespace pl::memory {
 namespace {
 
-constexpr size_t kMaxExactAnchorSize = 8;
-
-struct PatternByte {
-  uint8_t value = 0;
-  uint8_t mask = 0;
-};
+constexpr size_t kMaskedPairKeys = 1u << 16;
+constexpr size_t kScanChunkSize = 1u << 20;
+constexpr size_t kMinParallelScanBytes = 8u << 20;
+constexpr size_t kFingerprintSampleSize = 64u << 10;
+constexpr std::string_view kPersistentCacheHeader = "plsig1";
+constexpr size_t kMinHintWindow = 4u << 10;
+constexpr size_t kMaxHintWindow = 1u << 20;
+constexpr size_t kHintWindowGrowth = 16;
+constexpr uintptr_t kNoOffsetHint = UINTPTR_MAX;
+constexpr size_t kMaxFuzzyMismatches = 255;
+constexpr size_t kMaxIntersectedGrams = 3;
 
 struct ParsedPattern {
-  std::vector<PatternByte> bytes;
+  std::vector<SignatureByte> bytes;
   std::vector<size_t> checkIndices;
   size_t anchorIndex = 0;
   size_t anchorSize = 1;
+  std::vector<SignatureOp> derive;
 };
 
 struct MemoryRegion {
@@ -43,12 +77,23 @@ struct MemoryRegion {
 
 struct ModuleInfo {
   std::vector<MemoryRegion> regions;
-  void *handle = nullptr;
+  std::vector<MemoryRegion> codeRegions;
+  std::string path;
+  uintptr_t base = 0;
+  std::string cacheKey;
+};
+
+// A signature awaiting resolution and the index of its address in the
+// caller's output, so no stage has to key results by signature text.
+struct PendingSignature {
+  std::string_view text;
+  size_t slot = 0;
 };
 
 struct CompiledPattern {
-  std::string signature;
-  ParsedPattern pattern;
+  std::string_view signature;
+  std::shared_ptr<const ParsedPattern> pattern;
+  size_t slot = 0;
 };
 
 struct AnchorNode {
@@ -59,215 +104,580 @@ struct AnchorNode {
   AnchorNode() { next.fill(-1); }
 };
 
-std::unordered_map<std::string, ModuleInfo> moduleCache;
-std::unordered_map<std::string, uintptr_t> sigCache;
-std::unordered_map<std::string, ParsedPattern> patternCache;
+struct StringHash {
+  using is_transparent = void;
+
+  size_t operator()(std::string_view value) const noexcept {
+    return std::hash<std::string_view>{}(value);
+  }
+};
+
+template <typename T>
+using StringMap =
+    std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
+
+// Resolved addresses of one module and scan scope. A published table is never
+// modified: writers copy it, add their results and swap the copy in, so a
+// reader only needs the shared lock long enough to take a reference.
+using AddressTable = StringMap<uintptr_t>;
+
+struct ModuleSlot {
+  std::shared_ptr<const ModuleInfo> info;
+  std::vector<std::pair<std::string, std::shared_ptr<const AddressTable>>>
+      scopes;
+};
+
+// Module names are interned once into an index into moduleSlots.
+StringMap<size_t> moduleIds;
+std::vector<ModuleSlot> moduleSlots;
+StringMap<std::shared_ptr<const ParsedPattern>> patternCache;
+StringMap<std::vector<MemoryRegion>> sectionCache;
 std::shared_mutex cacheMutex;
+std::mutex cachePublishMutex;
+std::atomic<uint64_t> cachedModuleGeneration{0};
+std::once_flag glossInitOnce;
 
-int hexValue(char ch) {
-  if (ch >= '0' && ch <= '9') return ch - '0';
-  if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
-  if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
-  return -1;
-}
+// Collects what parseSignature reads into a ParsedPattern.
+struct PatternSink {
+  ParsedPattern &pattern;
 
-bool parsePatternToken(std::string_view token, PatternByte &byte) {
-  if (token == "?" || token == "??") {
-    byte = PatternByte{0, 0};
+  bool addByte(SignatureByte byte) {
+    if (byte.mask != 0) pattern.checkIndices.push_back(pattern.bytes.size());
+    pattern.bytes.push_back(byte);
     return true;
   }
-  if (token.size() != 2) return false;
+  bool addOp(SignatureOp op) {
+    pattern.derive.push_back(op);
+    return true;
+  }
+};
 
-  uint8_t value = 0;
-  uint8_t mask = 0;
-  for (size_t i = 0; i < token.size(); ++i) {
-    const char ch = token[i];
-    const auto shift = static_cast<uint8_t>((1 - i) * 4);
-    if (ch == '?') continue;
-    const int digit = hexValue(ch);
-    if (digit < 0) return false;
-    value |= static_cast<uint8_t>(digit << shift);
-    mask |= static_cast<uint8_t>(0xF << shift);
+ParsedPattern parsePattern(std::string_view signature) {
+  ParsedPattern pattern;
+  PatternSink sink{pattern};
+  if (!parseSignature(signature, sink)) {
+    pattern.bytes.clear();
+    pattern.checkIndices.clear();
+    pattern.derive.clear();
   }
+  return pattern;
+}
 
-  byte = PatternByte{value, mask};
-  return true;
+// sig<> literals arrive parsed and with their anchor already chosen.
+ParsedPattern makePattern(const PrecompiledSignature &signature) {
+  ParsedPattern pattern;
+  PatternSink sink{pattern};
+  for (const SignatureByte byte : signature.bytes) sink.addByte(byte);
+  pattern.derive.assign(signature.ops.begin(), signature.ops.end());
+  pattern.anchorIndex = signature.anchor.index;
+  pattern.anchorSize = signature.anchor.size;
+  return pattern;
 }
 
-void appendPatternByte(ParsedPattern &pattern, PatternByte byte) {
-  const size_t index = pattern.bytes.size();
-  if (byte.mask != 0) pattern.checkIndices.push_back(index);
-  pattern.bytes.push_back(byte);
+bool matches(SignatureByte pattern, uint8_t value) {
+  return (value & pattern.mask) == pattern.value;
 }
 
-bool appendPatternToken(std::string_view token, ParsedPattern &pattern) {
-  PatternByte byte{};
-  if (parsePatternToken(token, byte)) {
-    appendPatternByte(pattern, byte);
-    return true;
+bool isExactByte(SignatureByte byte) { return byte.mask == 0xFF; }
+
+void selectAnchor(ParsedPattern &pattern) {
+  const SignatureAnchor anchor = selectSignatureAnchor(pattern.bytes);
+  pattern.anchorIndex = anchor.index;
+  pattern.anchorSize = anchor.size;
+}
+
+void addRegion(std::vector<MemoryRegion> &regions, uintptr_t start,
+               uintptr_t end) {
+  if (!regions.empty() && regions.back().end >= start) {
+    regions.back().end = std::max(regions.back().end, end);
+    return;
   }
-  if (token.empty() || token.size() % 2 != 0) return false;
+  regions.push_back(MemoryRegion{start, end});
+}
 
-  for (size_t pos = 0; pos < token.size(); pos += 2) {
-    if (!parsePatternToken(token.substr(pos, 2), byte)) return false;
-    appendPatternByte(pattern, byte);
+uint64_t hashBytes(uint64_t hash, const char *data, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<uint8_t>(data[i]);
+    hash *= 0x100000001b3ull;
   }
-  return true;
+  return hash;
 }
 
-ParsedPattern parsePattern(std::string_view signature) {
-  ParsedPattern pattern;
-  size_t pos = 0;
-  while (pos < signature.size()) {
-    while (pos < signature.size() &&
-           std::isspace(static_cast<unsigned char>(signature[pos]))) {
-      ++pos;
-    }
-    if (pos >= signature.size()) break;
-
-    const size_t start = pos;
-    while (pos < signature.size() &&
-           !std::isspace(static_cast<unsigned char>(signature[pos]))) {
-      ++pos;
-    }
-    if (!appendPatternToken(signature.substr(start, pos - start), pattern)) {
-      pattern.bytes.clear();
-      pattern.checkIndices.clear();
-      break;
+// Fallback identity for modules built without a build-id note: the file size
+// plus a hash of its head and tail, which covers the ELF and section headers.
+std::string makeFileFingerprint(const std::string &path) {
+  FILE *file = std::fopen(path.c_str(), "rb");
+  if (!file) return {};
+
+  std::vector<char> buffer(kFingerprintSampleSize);
+  uint64_t hash = 0xcbf29ce484222325ull;
+  long fileSize = -1;
+  size_t read = std::fread(buffer.data(), 1, buffer.size(), file);
+  hash = hashBytes(hash, buffer.data(), read);
+  if (std::fseek(file, 0, SEEK_END) == 0) fileSize = std::ftell(file);
+  if (fileSize > static_cast<long>(buffer.size()) &&
+      std::fseek(file, -static_cast<long>(buffer.size()), SEEK_END) == 0) {
+    read = std::fread(buffer.data(), 1, buffer.size(), file);
+    hash = hashBytes(hash, buffer.data(), read);
+  }
+  std::fclose(file);
+  if (fileSize < 0) return {};
+
+  char fingerprint[64];
+  std::snprintf(fingerprint, sizeof(fingerprint), "s%ld-%016" PRIx64,
+                fileSize, hash);
+  return fingerprint;
+}
+
+bool getModuleInfo(const LoadedModule &image, ModuleInfo &out) {
+  for (const auto &segment : image.segments) {
+    if (!segment.readable) continue;
+    addRegion(out.regions, segment.start, segment.end);
+    if (segment.executable) {
+      addRegion(out.codeRegions, segment.start, segment.end);
     }
   }
-  return pattern;
+  if (out.regions.empty()) return false;
+
+  out.path = image.path;
+  out.base = image.base;
+  out.cacheKey = !image.buildId.empty() ? image.buildId
+                                        : makeFileFingerprint(image.path);
+  return true;
 }
 
-bool matches(PatternByte pattern, uint8_t value) {
-  return (value & pattern.mask) == pattern.value;
+// Callers hold cacheMutex.
+const ModuleSlot *findModuleSlot(std::string_view moduleName) {
+  const auto it = moduleIds.find(moduleName);
+  return it == moduleIds.end() ? nullptr : &moduleSlots[it->second];
+}
+
+// Callers hold cacheMutex exclusively.
+ModuleSlot &internModuleSlot(std::string_view moduleName) {
+  const auto [it, inserted] =
+      moduleIds.try_emplace(std::string(moduleName), moduleSlots.size());
+  if (inserted) moduleSlots.emplace_back();
+  return moduleSlots[it->second];
+}
+
+// Every counter of SignatureStats, so the totals can be kept one relaxed
+// atomic per field and resolves on different threads never share a lock.
+constexpr uint64_t SignatureStats::*kStatsFields[] = {
+    &SignatureStats::resolves,
+    &SignatureStats::signatures,
+    &SignatureStats::addressCacheHits,
+    &SignatureStats::symbolHits,
+    &SignatureStats::loaderSymbolHits,
+    &SignatureStats::persistentCacheHits,
+    &SignatureStats::persistentCacheMisses,
+    &SignatureStats::hintHits,
+    &SignatureStats::hintMisses,
+    &SignatureStats::indexedPatterns,
+    &SignatureStats::scannedPatterns,
+    &SignatureStats::notFound,
+    &SignatureStats::bytesScanned,
+    &SignatureStats::matcherStates,
+    &SignatureStats::candidates,
+    &SignatureStats::verificationFailures,
+    &SignatureStats::symbolNs,
+    &SignatureStats::cacheNs,
+    &SignatureStats::hintNs,
+    &SignatureStats::indexNs,
+    &SignatureStats::scanNs,
+    &SignatureStats::totalNs,
+};
+static_assert(sizeof(kStatsFields) / sizeof(kStatsFields[0]) ==
+                  sizeof(SignatureStats) / sizeof(uint64_t),
+              "every SignatureStats field needs a total");
+
+std::array<std::atomic<uint64_t>, std::size(kStatsFields)> totalStats{};
+std::atomic_bool statsLogging{false};
+
+uint64_t elapsedNs(std::chrono::steady_clock::time_point start) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
 }
 
-bool isExactByte(PatternByte byte) { return byte.mask == 0xFF; }
+// Adds the time between construction and destruction to one stats field.
+class PhaseTimer {
+public:
+  explicit PhaseTimer(uint64_t &target)
+      : mTarget(target), mStart(std::chrono::steady_clock::now()) {}
+  ~PhaseTimer() { mTarget += elapsedNs(mStart); }
+  PhaseTimer(const PhaseTimer &) = delete;
+  PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+private:
+  uint64_t &mTarget;
+  std::chrono::steady_clock::time_point mStart;
+};
 
-int maskBits(uint8_t mask) {
-  int count = 0;
-  while (mask != 0) {
-    mask &= static_cast<uint8_t>(mask - 1);
-    ++count;
+// Fields a resolve left at zero, most of them on a warm hit, are skipped.
+void addSignatureStats(const SignatureStats &stats) {
+  for (size_t i = 0; i < totalStats.size(); ++i) {
+    if (const uint64_t value = stats.*kStatsFields[i]) {
+      totalStats[i].fetch_add(value, std::memory_order_relaxed);
+    }
   }
-  return count;
 }
 
-void selectAnchor(ParsedPattern &pattern) {
-  if (pattern.checkIndices.empty()) return;
+// Stats of one resolve, added to the totals and optionally logged when it
+// goes out of scope.
+class ResolveStats {
+public:
+  explicit ResolveStats(std::string_view moduleName)
+      : mModuleName(moduleName), mStart(std::chrono::steady_clock::now()) {
+    stats.resolves = 1;
+  }
+  ~ResolveStats() {
+    stats.totalNs = elapsedNs(mStart);
+    addSignatureStats(stats);
+    if (!statsLogging.load(std::memory_order_relaxed)) return;
+    preloaderLogger.debug(
+        "signature resolve {}: {} signatures, {} resolved before, {} symbols "
+        "({} via loader), {} cached, {} hinted, {} indexed, {} scanned, "
+        "{} missing; {} bytes, {} matcher states, {} candidates, {} rejected; "
+        "{} us (symbols {}, cache {}, hints {}, index {}, scan {})",
+        mModuleName, stats.signatures, stats.addressCacheHits,
+        stats.symbolHits + stats.loaderSymbolHits, stats.loaderSymbolHits,
+        stats.persistentCacheHits, stats.hintHits, stats.indexedPatterns,
+        stats.scannedPatterns, stats.notFound, stats.bytesScanned,
+        stats.matcherStates, stats.candidates, stats.verificationFailures,
+        stats.totalNs / 1000, stats.symbolNs / 1000, stats.cacheNs / 1000,
+        stats.hintNs / 1000, stats.indexNs / 1000, stats.scanNs / 1000);
+  }
+  ResolveStats(const ResolveStats &) = delete;
+  ResolveStats &operator=(const ResolveStats &) = delete;
+
+  // Takes the signature and miss counts from the results about to be
+  // returned; address maps a result value to its address.
+  template <typename Results, typename Address>
+  void count(const Results &results, Address address) {
+    stats.signatures = results.size();
+    stats.notFound = static_cast<uint64_t>(
+        std::ranges::count_if(results, [&address](const auto &entry) {
+          return address(entry.second) == 0;
+        }));
+  }
 
-  size_t bestStart = 0;
-  size_t bestSize = 0;
-  for (size_t runStart = 0; runStart < pattern.bytes.size();) {
-    if (!isExactByte(pattern.bytes[runStart])) {
-      ++runStart;
-      continue;
-    }
+  void count(std::span<const uintptr_t> addresses) {
+    stats.signatures = addresses.size();
+    stats.notFound =
+        static_cast<uint64_t>(std::ranges::count(addresses, uintptr_t{0}));
+  }
 
-    size_t runEnd = runStart + 1;
-    while (runEnd < pattern.bytes.size() &&
-           isExactByte(pattern.bytes[runEnd])) {
-      ++runEnd;
-    }
+  SignatureStats stats;
+
+private:
+  std::string mModuleName;
+  std::chrono::steady_clock::time_point mStart;
+};
+
+// A loader handle held only around symbol lookups, so caching a module never
+// keeps it from being unloaded.
+class ModuleHandle {
+public:
+  explicit ModuleHandle(const ModuleInfo &module)
+      : mHandle(dlopen(module.path.c_str(), RTLD_LAZY | RTLD_NOLOAD)) {}
+  ~ModuleHandle() {
+    if (mHandle) dlclose(mHandle);
+  }
+  ModuleHandle(const ModuleHandle &) = delete;
+  ModuleHandle &operator=(const ModuleHandle &) = delete;
+
+  void *findSymbol(const std::string &name) const {
+    return mHandle ? dlsym(mHandle, name.c_str()) : nullptr;
+  }
+
+private:
+  void *mHandle = nullptr;
+};
+
+// Text with a space, '?' or '|' can only be a pattern, and so can a run of
+// hex digits starting with a digit, since no identifier does. Any other run of
+// identifier characters, hex words like "beef" included, is tried as a symbol
+// name first; resolveSymbols hands the ones that miss back as patterns.
+bool isSymbolName(std::string_view signature) {
+  if (signature.empty() ||
+      std::isdigit(static_cast<unsigned char>(signature.front()))) {
+    return false;
+  }
+  return std::ranges::all_of(signature, [](char ch) {
+    return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' ||
+           ch == '.' || ch == '$' || ch == '@';
+  });
+}
 
-    const size_t size = std::min(runEnd - runStart, kMaxExactAnchorSize);
-    const size_t start = runEnd - size;
-    if (size > bestSize || (size == bestSize && start > bestStart)) {
-      bestStart = start;
-      bestSize = size;
+// Looks every symbol-like signature up in the image's own symbol tables in
+// one batch. Only names those lack, such as IFUNCs or symbols of
+// dependencies, go to the loader, and only when the module is loaded; the
+// rest are appended to patterns.
+void resolveSymbols(const LoadedModule *image, const ModuleInfo *loaded,
+                    const std::vector<PendingSignature> &symbols,
+                    std::span<uintptr_t> addresses,
+                    std::vector<PendingSignature> &patterns,
+                    SignatureStats &stats) {
+  if (symbols.empty()) return;
+
+  PhaseTimer timer(stats.symbolNs);
+  std::vector<std::string_view> names;
+  names.reserve(symbols.size());
+  for (const auto &symbol : symbols) names.push_back(symbol.text);
+  auto found = image ? findElfSymbols(*image, names)
+                     : std::vector<uintptr_t>(symbols.size());
+  stats.symbolHits += static_cast<uint64_t>(
+      symbols.size() - std::ranges::count(found, 0));
+  if (loaded && std::ranges::find(found, 0) != found.end()) {
+    const ModuleHandle handle(*loaded);
+    for (size_t i = 0; i < symbols.size(); ++i) {
+      if (found[i] != 0) continue;
+      found[i] = reinterpret_cast<uintptr_t>(
+          handle.findSymbol(std::string(names[i])));
+      stats.loaderSymbolHits += found[i] != 0;
+    }
+  }
+  for (size_t i = 0; i < symbols.size(); ++i) {
+    if (found[i] != 0) {
+      addresses[symbols[i].slot] = found[i];
+    } else {
+      patterns.push_back(symbols[i]);
     }
-    runStart = runEnd;
   }
+}
 
-  if (bestSize != 0) {
-    pattern.anchorIndex = bestStart;
-    pattern.anchorSize = bestSize;
-    return;
+// Splits signatures into symbol names and patterns.
+void classifySignatures(std::span<const PendingSignature> signatures,
+                        std::vector<PendingSignature> &symbols,
+                        std::vector<PendingSignature> &patterns) {
+  patterns.reserve(signatures.size());
+  for (const auto &signature : signatures) {
+    (isSymbolName(signature.text) ? symbols : patterns).push_back(signature);
   }
+}
 
-  size_t bestIndex = pattern.checkIndices.front();
-  int bestBits = maskBits(pattern.bytes[bestIndex].mask);
-  for (const size_t index : pattern.checkIndices) {
-    const int bits = maskBits(pattern.bytes[index].mask);
-    if (bits > bestBits || (bits == bestBits && index > bestIndex)) {
-      bestIndex = index;
-      bestBits = bits;
+bool isSameImage(const LoadedModule *image, const ModuleInfo &module) {
+  return image && image->base == module.base && image->path == module.path;
+}
+
+// Forgets everything cached for modules that were unloaded or reloaded at a
+// different address since the module map last changed. Returns the current
+// map; when nothing was loaded or unloaded this is only a generation check.
+std::shared_ptr<const ModuleMap> syncModuleCaches() {
+  auto map = getModuleMap();
+  if (map->generation() ==
+      cachedModuleGeneration.load(std::memory_order_acquire)) {
+    return map;
+  }
+
+  std::unique_lock lock(cacheMutex);
+  for (const auto &[name, index] : moduleIds) {
+    auto &slot = moduleSlots[index];
+    if (!slot.info || isSameImage(map->findModule(name), *slot.info)) {
+      continue;
     }
+    slot.info.reset();
+    slot.scopes.clear();
+    const std::string prefix = name + "::";
+    std::erase_if(sectionCache, [&prefix](const auto &entry) {
+      return entry.first.starts_with(prefix);
+    });
   }
-  pattern.anchorIndex = bestIndex;
-  pattern.anchorSize = 1;
+  cachedModuleGeneration.store(map->generation(), std::memory_order_release);
+  return map;
 }
 
-bool parseMapsLine(const char *line, const std::string &moduleName,
-                   MemoryRegion &region) {
-  if (std::strstr(line, moduleName.c_str()) == nullptr) return false;
+// Syncs only when a recent look at the loader found the map moved, so warm
+// lookups skip the loader walk. Cached addresses are checked against a recent
+// map only, so an image that is unloaded can keep answering for a few
+// milliseconds; anything that has to read the map checks the loader again.
+void syncRecentModuleCaches() {
+  if (getRecentModuleMapGeneration() !=
+      cachedModuleGeneration.load(std::memory_order_acquire)) {
+    syncModuleCaches();
+  }
+}
 
-  uintptr_t start = 0;
-  uintptr_t end = 0;
-  char perms[5] = {};
-  if (std::sscanf(line, "%" SCNxPTR "-%" SCNxPTR " %4s", &start, &end,
-                  perms) != 3) {
-    return false;
+std::shared_ptr<const ModuleInfo>
+getCachedModuleInfo(const ModuleMap &map, std::string_view moduleName) {
+  {
+    std::shared_lock lock(cacheMutex);
+    const auto *slot = findModuleSlot(moduleName);
+    if (slot && slot->info) return slot->info;
   }
-  if (end <= start || perms[0] != 'r') return false;
-  region = MemoryRegion{start, end};
-  return true;
+
+  const auto *image = map.findModule(moduleName);
+  auto module = std::make_shared<ModuleInfo>();
+  if (!image || !getModuleInfo(*image, *module)) return nullptr;
+
+  std::unique_lock lock(cacheMutex);
+  auto &slot = internModuleSlot(moduleName);
+  if (!slot.info) slot.info = std::move(module);
+  return slot.info;
 }
 
-void addReadableRegion(ModuleInfo &module, uintptr_t start, uintptr_t end) {
-  if (!module.regions.empty() && module.regions.back().end == start) {
-    module.regions.back().end = end;
-    return;
+std::shared_ptr<const AddressTable>
+getAddressTable(std::string_view moduleName, std::string_view scopeTag) {
+  std::shared_lock lock(cacheMutex);
+  const auto *slot = findModuleSlot(moduleName);
+  if (!slot) return nullptr;
+  for (const auto &[tag, table] : slot->scopes) {
+    if (tag == scopeTag) return table;
   }
-  module.regions.push_back(MemoryRegion{start, end});
+  return nullptr;
 }
 
-bool getModuleInfo(const std::string &name, ModuleInfo &out) {
-  FILE *maps = std::fopen("/proc/self/maps", "r");
-  if (!maps) return false;
+// Slots set in unsettled are left out, so later resolves look them up again.
+void publishAddresses(std::string_view moduleName,
+                      const std::shared_ptr<const ModuleInfo> &module,
+                      std::string_view scopeTag,
+                      std::span<const PendingSignature> signatures,
+                      std::span<const uintptr_t> addresses,
+                      const std::vector<bool> &unsettled) {
+  std::lock_guard publish(cachePublishMutex);
+  const auto current = getAddressTable(moduleName, scopeTag);
+  auto table = current ? std::make_shared<AddressTable>(*current)
+                       : std::make_shared<AddressTable>();
+  for (const auto &signature : signatures) {
+    if (unsettled[signature.slot]) continue;
+    (*table)[std::string(signature.text)] = addresses[signature.slot];
+  }
 
-  char line[4096];
-  while (std::fgets(line, sizeof(line), maps)) {
-    MemoryRegion region{};
-    if (parseMapsLine(line, name, region)) {
-      addReadableRegion(out, region.start, region.end);
+  std::unique_lock lock(cacheMutex);
+  auto &slot = internModuleSlot(moduleName);
+  // The module was unloaded while these addresses were being resolved.
+  if (slot.info != module) return;
+  for (auto &[tag, published] : slot.scopes) {
+    if (tag == scopeTag) {
+      published = std::move(table);
+      return;
     }
   }
-  std::fclose(maps);
-  if (out.regions.empty()) return false;
+  slot.scopes.emplace_back(std::string(scopeTag), std::move(table));
+}
 
-  out.handle = dlopen(name.c_str(), RTLD_LAZY | RTLD_NOLOAD);
-  if (!out.handle) out.handle = dlopen(name.c_str(), RTLD_LAZY);
-  return true;
+void ensureGlossInitialized() {
+  std::call_once(glossInitOnce, [] { GlossInit(true); });
+}
+
+std::vector<MemoryRegion> clipRegions(const std::vector<MemoryRegion> &regions,
+                                      uintptr_t start, uintptr_t end) {
+  std::vector<MemoryRegion> clipped;
+  for (const auto &region : regions) {
+    const uintptr_t clippedStart = std::max(region.start, start);
+    const uintptr_t clippedEnd = std::min(region.end, end);
+    if (clippedStart < clippedEnd) {
+      clipped.push_back(MemoryRegion{clippedStart, clippedEnd});
+    }
+  }
+  return clipped;
 }
 
-ModuleInfo getCachedModuleInfo(const std::string &moduleName) {
+std::vector<MemoryRegion> getSectionRegions(const ModuleInfo &module,
+                                            const std::string &moduleName,
+                                            const std::string &section) {
+  const std::string key = moduleName + "::" + section;
   {
     std::shared_lock lock(cacheMutex);
-    const auto it = moduleCache.find(moduleName);
-    if (it != moduleCache.end()) return it->second;
+    const auto it = sectionCache.find(key);
+    if (it != sectionCache.end()) return it->second;
   }
 
-  ModuleInfo module;
-  if (!getModuleInfo(moduleName, module)) return {};
+  ensureGlossInitialized();
+  size_t size = 0;
+  const uintptr_t start =
+      GlossGetLibSection(moduleName.c_str(), section.c_str(), &size);
+  std::vector<MemoryRegion> regions;
+  if (start != 0 && size != 0) {
+    regions = clipRegions(module.regions, start, start + size);
+  } else {
+    preloaderLogger.warn("signature scan section {} not found in {}", section,
+                         moduleName);
+  }
 
   std::unique_lock lock(cacheMutex);
-  const auto [it, inserted] = moduleCache.emplace(moduleName, module);
-  return inserted ? module : it->second;
+  sectionCache.emplace(key, regions);
+  return regions;
+}
+
+std::vector<MemoryRegion> getScanRegions(const ModuleInfo &module,
+                                         const std::string &moduleName,
+                                         const SignatureScanOptions &options) {
+  switch (options.scope) {
+  case SignatureScope::Readable:
+    return module.regions;
+  case SignatureScope::Executable:
+    return module.codeRegions;
+  case SignatureScope::Section:
+    if (options.section.empty()) return {};
+    return getSectionRegions(module, moduleName, options.section);
+  }
+  return {};
+}
+
+size_t normalizeAlignment(size_t alignment) {
+  return alignment != 0 && (alignment & (alignment - 1)) == 0 ? alignment
+                                                              : 1;
+}
+
+size_t getScanAlignment(const SignatureScanOptions &options) {
+  return normalizeAlignment(options.alignment);
+}
+
+std::string makeScopeTag(const SignatureScanOptions &options) {
+  std::string tag;
+  switch (options.scope) {
+  case SignatureScope::Readable:
+    break;
+  case SignatureScope::Executable:
+    tag = "x";
+    break;
+  case SignatureScope::Section:
+    tag = "s" + options.section;
+    break;
+  }
+  // Aligned scans find a subset of the matches, so they are cached apart.
+  if (const size_t alignment = getScanAlignment(options); alignment > 1) {
+    tag += "@" + std::to_string(alignment);
+  }
+  return tag;
 }
 
-ParsedPattern getCachedPattern(const std::string &signature) {
+std::shared_ptr<const ParsedPattern>
+getCachedPattern(std::string_view signature) {
   {
     std::shared_lock lock(cacheMutex);
     const auto it = patternCache.find(signature);
     if (it != patternCache.end()) return it->second;
   }
 
-  ParsedPattern pattern = parsePattern(signature);
+  auto pattern = std::make_shared<ParsedPattern>(parsePattern(signature));
+  if (!pattern->bytes.empty()) selectAnchor(*pattern);
   std::unique_lock lock(cacheMutex);
-  const auto [it, inserted] = patternCache.emplace(signature, pattern);
-  return inserted ? pattern : it->second;
+  return patternCache.emplace(std::string(signature), std::move(pattern))
+      .first->second;
+}
+
+// Stores the compile-time parse of each literal so the scan never parses it.
+void seedPatternCache(std::span<const PrecompiledSignature> signatures) {
+  {
+    std::shared_lock lock(cacheMutex);
+    if (std::all_of(signatures.begin(), signatures.end(),
+                    [](const PrecompiledSignature &signature) {
+                      return patternCache.contains(signature.text);
+                    })) {
+      return;
+    }
+  }
+
+  std::unique_lock lock(cacheMutex);
+  for (const auto &signature : signatures) {
+    if (patternCache.contains(signature.text)) continue;
+    patternCache.emplace(
+        std::string(signature.text),
+        std::make_shared<const ParsedPattern>(makePattern(signature)));
+  }
 }
 
 bool matchesPatternAt(const uint8_t *data, const ParsedPattern &pattern) {
@@ -293,44 +703,131 @@ bool matchesAnchorAt(const uint8_t *data, size_t regionSize,
   return true;
 }
 
+// Malformed signatures are left out, so their addresses stay 0.
 std::vector<CompiledPattern>
-compilePatterns(const std::vector<std::string> &signatures,
-                std::unordered_map<std::string, uintptr_t> &results) {
+compilePatterns(std::span<const PendingSignature> signatures) {
   std::vector<CompiledPattern> compiled;
   compiled.reserve(signatures.size());
   for (const auto &signature : signatures) {
-    auto pattern = getCachedPattern(signature);
-    if (pattern.bytes.empty()) {
-      preloaderLogger.warn("invalid signature pattern: {}", signature);
-      results[signature] = 0;
+    auto pattern = getCachedPattern(signature.text);
+    if (pattern->bytes.empty()) {
+      preloaderLogger.warn("invalid signature pattern: {}", signature.text);
       continue;
     }
-    selectAnchor(pattern);
-    compiled.push_back(CompiledPattern{signature, std::move(pattern)});
+    compiled.push_back(
+        CompiledPattern{signature.text, std::move(pattern), signature.slot});
   }
   return compiled;
 }
 
+// Slots are indexes into signatures.
+std::vector<CompiledPattern>
+compileBufferSignatures(std::span<const std::string> signatures) {
+  std::vector<PendingSignature> pending;
+  pending.reserve(signatures.size());
+  for (size_t i = 0; i < signatures.size(); ++i) {
+    pending.push_back(PendingSignature{signatures[i], i});
+  }
+  return compilePatterns(pending);
+}
+
+bool hasExactAnchor(const ParsedPattern &pattern) {
+  for (size_t i = 0; i < pattern.anchorSize; ++i) {
+    if (!isExactByte(pattern.bytes[pattern.anchorIndex + i])) return false;
+  }
+  return true;
+}
+
+// Masked anchors bucketed by every value they accept, so the scan does one
+// table lookup per byte instead of testing each masked pattern. One-byte
+// anchors are keyed by that byte, two-byte anchors by both bytes together.
+struct MaskedAnchorIndex {
+  std::array<uint32_t, 257> begin{};
+  std::vector<uint32_t> patterns;
+  std::vector<uint32_t> pairBegin;
+  std::vector<uint32_t> pairPatterns;
+};
+
+std::vector<uint32_t> acceptedValues(SignatureByte byte) {
+  std::vector<uint32_t> values;
+  for (uint32_t value = 0; value < 256; ++value) {
+    if (matches(byte, static_cast<uint8_t>(value))) values.push_back(value);
+  }
+  return values;
+}
+
+template <typename Begin>
+void fillMaskedBuckets(const std::vector<size_t> &members,
+                       const std::vector<std::vector<uint32_t>> &keys,
+                       Begin &begin, std::vector<uint32_t> &bucketed) {
+  const size_t keyCount = begin.size() - 1;
+  std::vector<uint32_t> counts(keyCount, 0);
+  for (const auto &memberKeys : keys) {
+    for (const uint32_t key : memberKeys) ++counts[key];
+  }
+
+  uint32_t total = 0;
+  for (size_t key = 0; key < keyCount; ++key) {
+    begin[key] = total;
+    total += counts[key];
+    counts[key] = begin[key];
+  }
+  begin[keyCount] = total;
+
+  bucketed.assign(total, 0);
+  for (size_t i = 0; i < members.size(); ++i) {
+    for (const uint32_t key : keys[i]) {
+      bucketed[counts[key]++] = static_cast<uint32_t>(members[i]);
+    }
+  }
+}
+
+MaskedAnchorIndex
+buildMaskedAnchorIndex(const std::vector<CompiledPattern> &patterns,
+                       const std::vector<bool> &active) {
+  std::vector<size_t> singles;
+  std::vector<size_t> pairs;
+  std::vector<std::vector<uint32_t>> singleKeys;
+  std::vector<std::vector<uint32_t>> pairKeys;
+  for (size_t patternIndex = 0; patternIndex < patterns.size();
+       ++patternIndex) {
+    const auto &pattern = *patterns[patternIndex].pattern;
+    if (!active[patternIndex] || hasExactAnchor(pattern)) continue;
+
+    const auto first = acceptedValues(pattern.bytes[pattern.anchorIndex]);
+    if (pattern.anchorSize == 1) {
+      singles.push_back(patternIndex);
+      singleKeys.push_back(first);
+      continue;
+    }
+
+    std::vector<uint32_t> keys;
+    for (const uint32_t second :
+         acceptedValues(pattern.bytes[pattern.anchorIndex + 1])) {
+      for (const uint32_t value : first) keys.push_back(value | second << 8);
+    }
+    pairs.push_back(patternIndex);
+    pairKeys.push_back(std::move(keys));
+  }
+
+  MaskedAnchorIndex index;
+  fillMaskedBuckets(singles, singleKeys, index.begin, index.patterns);
+  if (!pairs.empty()) {
+    index.pairBegin.resize(kMaskedPairKeys + 1);
+    fillMaskedBuckets(pairs, pairKeys, index.pairBegin, index.pairPatterns);
+  }
+  return index;
+}
+
 std::vector<AnchorNode>
 buildAnchorAutomaton(const std::vector<CompiledPattern> &patterns,
-                     const std::vector<bool> &active,
-                     std::vector<size_t> &maskedPatterns) {
+                     const std::vector<bool> &active) {
   std::vector<AnchorNode> nodes(1);
 
   for (size_t index = 0; index < patterns.size(); ++index) {
     if (!active[index]) continue;
-    const auto &pattern = patterns[index].pattern;
-    bool exact = true;
-    for (size_t i = 0; i < pattern.anchorSize; ++i) {
-      if (!isExactByte(pattern.bytes[pattern.anchorIndex + i])) {
-        exact = false;
-        break;
-      }
-    }
-    if (!exact) {
-      maskedPatterns.push_back(index);
-      continue;
-    }
+    const auto &pattern = *patterns[index].pattern;
+    if (!hasExactAnchor(pattern)) continue;
 
     int state = 0;
     for (size_t i = 0; i < pattern.anchorSize; ++i) {
@@ -379,155 +876,3192 @@ buildAnchorAutomaton(const std::vector<CompiledPattern> &patterns,
   return nodes;
 }
 
-void scanCompiledPatterns(const std::vector<MemoryRegion> &regions,
-                          const std::vector<CompiledPattern> &patterns,
-                          std::unordered_map<std::string, uintptr_t> &results) {
-  if (patterns.empty()) return;
+// Same automaton as buildAnchorAutomaton, packed for the scan loop: bytes
+// that no anchor uses share one class, states are 16-bit, and the outputs of
+// every state live in one flat array.
+struct CompactAutomaton {
+  std::array<uint8_t, 256> byteClass{};
+  size_t classCount = 1;
+  std::vector<uint16_t> next;
+  std::vector<uint32_t> outputBegin;
+  std::vector<uint32_t> outputs;
+};
 
-  std::vector<uintptr_t> found(patterns.size(), 0);
-  std::vector<bool> active(patterns.size(), true);
-  size_t unresolved = patterns.size();
+bool buildCompactAutomaton(const std::vector<CompiledPattern> &patterns,
+                           const std::vector<bool> &active,
+                           CompactAutomaton &automaton) {
+  constexpr uint16_t kNoState = UINT16_MAX;
 
-  if (regions.empty()) {
-    unresolved = 0;
-  } else {
-    for (size_t i = 0; i < patterns.size(); ++i) {
-      if (patterns[i].pattern.checkIndices.empty()) {
-        found[i] = regions.front().start;
-        active[i] = false;
-        --unresolved;
-      }
+  std::array<bool, 256> used{};
+  for (size_t index = 0; index < patterns.size(); ++index) {
+    if (!active[index] || !hasExactAnchor(*patterns[index].pattern)) continue;
+    const auto &pattern = *patterns[index].pattern;
+    for (size_t i = 0; i < pattern.anchorSize; ++i) {
+      used[pattern.bytes[pattern.anchorIndex + i].value] = true;
     }
   }
+  const bool allUsed = std::all_of(used.begin(), used.end(),
+                                   [](bool value) { return value; });
+  automaton.classCount = allUsed ? 0 : 1;
+  for (size_t value = 0; value < 256; ++value) {
+    automaton.byteClass[value] =
+        used[value] ? static_cast<uint8_t>(automaton.classCount++) : 0;
+  }
 
-  std::vector<size_t> maskedPatterns;
-  const auto nodes = buildAnchorAutomaton(patterns, active, maskedPatterns);
+  const size_t classCount = automaton.classCount;
+  auto &next = automaton.next;
+  std::vector<std::vector<uint32_t>> stateOutputs(1);
+  next.assign(classCount, kNoState);
 
-  auto tryMatch = [&](const MemoryRegion &region, const uint8_t *data,
-                      size_t regionSize, size_t anchorOffset,
-                      size_t patternIndex) {
-    if (!active[patternIndex]) return;
-    const auto &pattern = patterns[patternIndex].pattern;
-    if (regionSize < pattern.bytes.size() ||
-        anchorOffset < pattern.anchorIndex ||
-        !matchesAnchorAt(data, regionSize, anchorOffset, pattern)) {
-      return;
+  for (size_t index = 0; index < patterns.size(); ++index) {
+    if (!active[index] || !hasExactAnchor(*patterns[index].pattern)) continue;
+    const auto &pattern = *patterns[index].pattern;
+    size_t state = 0;
+    for (size_t i = 0; i < pattern.anchorSize; ++i) {
+      const uint8_t byteClass =
+          automaton.byteClass[pattern.bytes[pattern.anchorIndex + i].value];
+      uint16_t &target = next[state * classCount + byteClass];
+      if (target == kNoState) {
+        if (stateOutputs.size() >= kNoState) return false;
+        target = static_cast<uint16_t>(stateOutputs.size());
+        stateOutputs.emplace_back();
+        next.resize(next.size() + classCount, kNoState);
+      }
+      state = next[state * classCount + byteClass];
     }
+    stateOutputs[state].push_back(static_cast<uint32_t>(index));
+  }
 
-    const size_t candidateOffset = anchorOffset - pattern.anchorIndex;
-    if (candidateOffset > regionSize - pattern.bytes.size() ||
-        !matchesPatternAt(data + candidateOffset, pattern)) {
-      return;
+  std::vector<uint16_t> failure(stateOutputs.size(), 0);
+  std::queue<uint16_t> queue;
+  for (size_t byteClass = 0; byteClass < classCount; ++byteClass) {
+    uint16_t &target = next[byteClass];
+    if (target == kNoState) {
+      target = 0;
+    } else {
+      queue.push(target);
     }
+  }
 
-    found[patternIndex] = region.start + candidateOffset;
-    active[patternIndex] = false;
-    --unresolved;
-  };
-
-  for (const auto &region : regions) {
-    if (unresolved == 0) break;
-    const auto *data = reinterpret_cast<const uint8_t *>(region.start);
-    const size_t regionSize = region.end - region.start;
-    int state = 0;
-
-    for (size_t offset = 0; offset < regionSize && unresolved != 0; ++offset) {
-      state = nodes[state].next[data[offset]];
-      for (const size_t patternIndex : nodes[state].outputs) {
-        const auto anchorSize = patterns[patternIndex].pattern.anchorSize;
-        if (offset + 1 >= anchorSize) {
-          tryMatch(region, data, regionSize, offset + 1 - anchorSize,
-                   patternIndex);
-        }
+  while (!queue.empty()) {
+    const uint16_t state = queue.front();
+    queue.pop();
+    const size_t row = static_cast<size_t>(state) * classCount;
+    const size_t failureRow = static_cast<size_t>(failure[state]) * classCount;
+    for (size_t byteClass = 0; byteClass < classCount; ++byteClass) {
+      uint16_t &target = next[row + byteClass];
+      if (target == kNoState) {
+        target = next[failureRow + byteClass];
+        continue;
       }
 
-      for (const size_t patternIndex : maskedPatterns) {
-        if (!active[patternIndex]) continue;
-        const auto &pattern = patterns[patternIndex].pattern;
-        if (matches(pattern.bytes[pattern.anchorIndex], data[offset])) {
-          tryMatch(region, data, regionSize, offset, patternIndex);
-        }
-      }
+      const uint16_t fallback = next[failureRow + byteClass];
+      failure[target] = fallback;
+      const auto &inherited = stateOutputs[fallback];
+      stateOutputs[target].insert(stateOutputs[target].end(),
+                                  inherited.begin(), inherited.end());
+      queue.push(target);
     }
   }
 
-  for (size_t i = 0; i < patterns.size(); ++i) {
-    results[patterns[i].signature] = found[i];
+  automaton.outputBegin.clear();
+  automaton.outputBegin.reserve(stateOutputs.size() + 1);
+  automaton.outputs.clear();
+  for (const auto &outputs : stateOutputs) {
+    automaton.outputBegin.push_back(
+        static_cast<uint32_t>(automaton.outputs.size()));
+    automaton.outputs.insert(automaton.outputs.end(), outputs.begin(),
+                             outputs.end());
   }
+  automaton.outputBegin.push_back(
+      static_cast<uint32_t>(automaton.outputs.size()));
+  return true;
 }
 
-std::string makeSignatureCacheKey(std::string_view moduleName,
-                                  std::string_view signature) {
-  std::string key;
-  key.reserve(moduleName.size() + signature.size() + 2);
-  key.append(moduleName).append("::").append(signature);
-  return key;
+// Bit-parallel Shift-And over all exact anchors at once. Every anchor byte
+// owns one bit, so this only applies while the anchors fit in 64 bits.
+struct ShiftAndMatcher {
+  std::array<uint64_t, 256> masks{};
+  uint64_t starts = 0;
+  uint64_t accepts = 0;
+  std::array<uint32_t, 64> patternAt{};
+};
+
+bool buildShiftAndMatcher(const std::vector<CompiledPattern> &patterns,
+                          const std::vector<bool> &active,
+                          ShiftAndMatcher &matcher) {
+  size_t bit = 0;
+  for (size_t index = 0; index < patterns.size(); ++index) {
+    if (!active[index] || !hasExactAnchor(*patterns[index].pattern)) continue;
+    const auto &pattern = *patterns[index].pattern;
+    if (bit + pattern.anchorSize > 64) return false;
+
+    matcher.starts |= uint64_t{1} << bit;
+    for (size_t i = 0; i < pattern.anchorSize; ++i, ++bit) {
+      matcher.masks[pattern.bytes[pattern.anchorIndex + i].value] |=
+          uint64_t{1} << bit;
+    }
+    matcher.accepts |= uint64_t{1} << (bit - 1);
+    matcher.patternAt[bit - 1] = static_cast<uint32_t>(index);
+  }
+  return bit != 0;
 }
 
+#if defined(__AVX2__)
+constexpr size_t kSimdWidth = 32;
+constexpr int kLaneShift = 0;
+using LaneMask = uint32_t;
+#elif defined(__SSE2__)
+constexpr size_t kSimdWidth = 16;
+constexpr int kLaneShift = 0;
+using LaneMask = uint32_t;
+#elif defined(__ARM_NEON)
+constexpr size_t kSimdWidth = 16;
+constexpr int kLaneShift = 2;
+using LaneMask = uint64_t;
+#else
+constexpr size_t kSimdWidth = 0;
+constexpr int kLaneShift = 0;
+using LaneMask = uint32_t;
+#endif
+
+constexpr size_t kMaxPrefilterPairs = 8;
+constexpr size_t kMaxPrefilterDistance = 15;
+// Past this many pairs the bucketed filter below is faster where it exists;
+// the prefilter still takes up to kMaxPrefilterPairs everywhere else.
+constexpr size_t kPreferredPrefilterPairs = 2;
+// Masked anchors only pin high nibbles, so two masked pairs already pass more
+// candidates than the hashed filter's 8-byte windows.
+constexpr size_t kPreferredMaskedPrefilterPairs = 1;
+
+struct AnchorPair {
+  SignatureByte first;
+  SignatureByte second;
+  size_t distance = 0;
+  size_t phase = 0; // anchorIndex modulo the scan alignment
+  std::vector<size_t> patterns;
+};
+
+// Candidate filter over anchors: a position is handed to verification only
+// when two checked bytes of some pattern match there. The first byte of each
+// anchor pairs up with the rarest checked byte that follows it.
+struct AnchorPrefilter {
+  std::vector<AnchorPair> pairs;
+  size_t maxDistance = 0;
+};
+
+LaneMask matchPairMask(const uint8_t *data, const AnchorPair &pair) {
+#if defined(__AVX2__)
+  auto matchByte = [](const uint8_t *bytes, SignatureByte byte) {
+    __m256i loaded =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bytes));
+    if (byte.mask != 0xFF) {
+      loaded = _mm256_and_si256(
+          loaded, _mm256_set1_epi8(static_cast<char>(byte.mask)));
+    }
+    return _mm256_cmpeq_epi8(loaded,
+                             _mm256_set1_epi8(static_cast<char>(byte.value)));
+  };
+  const __m256i hits =
+      _mm256_and_si256(matchByte(data, pair.first),
+                       matchByte(data + pair.distance, pair.second));
+  return static_cast<LaneMask>(_mm256_movemask_epi8(hits));
+#elif defined(__SSE2__)
+  auto matchByte = [](const uint8_t *bytes, SignatureByte byte) {
+    __m128i loaded = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+    if (byte.mask != 0xFF) {
+      loaded =
+          _mm_and_si128(loaded, _mm_set1_epi8(static_cast<char>(byte.mask)));
+    }
+    return _mm_cmpeq_epi8(loaded,
+                          _mm_set1_epi8(static_cast<char>(byte.value)));
+  };
+  const __m128i hits =
+      _mm_and_si128(matchByte(data, pair.first),
+                    matchByte(data + pair.distance, pair.second));
+  return static_cast<LaneMask>(_mm_movemask_epi8(hits));
+#elif defined(__ARM_NEON)
+  auto matchByte = [](const uint8_t *bytes, SignatureByte byte) {
+    uint8x16_t loaded = vld1q_u8(bytes);
+    if (byte.mask != 0xFF) loaded = vandq_u8(loaded, vdupq_n_u8(byte.mask));
+    return vceqq_u8(loaded, vdupq_n_u8(byte.value));
+  };
+  const uint8x16_t hits =
+      vandq_u8(matchByte(data, pair.first),
+               matchByte(data + pair.distance, pair.second));
+  // Narrow every 0x00/0xFF lane to one nibble of a 64-bit mask.
+  const uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(hits), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+#else
+  (void)data;
+  (void)pair;
+  return 0;
+#endif
 }
 
-std::unordered_map<std::string, uintptr_t>
-resolveSignatures(std::span<const std::string> signatures,
-                  std::string_view moduleName) {
-  std::unordered_map<std::string, uintptr_t> results;
-  std::vector<std::string> pending;
-  std::unordered_map<std::string, size_t> pendingLookup;
+size_t nextLane(LaneMask &mask) {
+  const size_t bit = static_cast<size_t>(__builtin_ctzll(mask));
+  const size_t lane = bit >> kLaneShift;
+  constexpr LaneMask laneBits = (LaneMask{1} << (1 << kLaneShift)) - 1;
+  mask &= ~(laneBits << (lane << kLaneShift));
+  return lane;
+}
 
-  if (moduleName.empty()) {
-    for (const auto &signature : signatures) results[signature] = 0;
-    return results;
-  }
+bool sameSignatureByte(SignatureByte left, SignatureByte right) {
+  return left.value == right.value && left.mask == right.mask;
+}
 
-  {
-    std::shared_lock lock(cacheMutex);
-    for (const auto &signature : signatures) {
-      const auto key = makeSignatureCacheKey(moduleName, signature);
-      const auto cached = sigCache.find(key);
-      if (cached != sigCache.end()) {
-        results[signature] = cached->second;
-      } else if (pendingLookup.emplace(signature, pending.size()).second) {
-        pending.push_back(signature);
-      }
+AnchorPair selectAnchorPair(const ParsedPattern &pattern, size_t alignment) {
+  const SignatureByte first = pattern.bytes[pattern.anchorIndex];
+  AnchorPair pair{first, first, 0, pattern.anchorIndex & (alignment - 1), {}};
+  int bestScore = 0;
+  for (const size_t index : pattern.checkIndices) {
+    if (index <= pattern.anchorIndex) continue;
+    const size_t distance = index - pattern.anchorIndex;
+    if (distance > kMaxPrefilterDistance) break;
+    const int score = detail::byteRarity(pattern.bytes[index]);
+    if (score > bestScore) {
+      pair.second = pattern.bytes[index];
+      pair.distance = distance;
+      bestScore = score;
     }
   }
+  return pair;
+}
 
-  if (pending.empty()) return results;
+bool buildAnchorPrefilter(const std::vector<CompiledPattern> &patterns,
+                          const std::vector<bool> &active, size_t alignment,
+                          AnchorPrefilter &prefilter) {
+  if (kSimdWidth == 0) return false;
 
-  const ModuleInfo module = getCachedModuleInfo(std::string(moduleName));
-  if (module.regions.empty()) {
-    for (const auto &signature : pending) results[signature] = 0;
-  } else {
-    std::vector<std::string> patterns;
-    patterns.reserve(pending.size());
-    for (const auto &signature : pending) {
-      if (module.handle) {
-        if (void *symbol = dlsym(module.handle, signature.c_str())) {
-          results[signature] = reinterpret_cast<uintptr_t>(symbol);
-          continue;
-        }
-      }
-      patterns.push_back(signature);
+  for (size_t index = 0; index < patterns.size(); ++index) {
+    if (!active[index]) continue;
+    const AnchorPair candidate =
+        selectAnchorPair(*patterns[index].pattern, alignment);
+    const size_t distance = candidate.distance;
+
+    auto it = std::find_if(
+        prefilter.pairs.begin(), prefilter.pairs.end(),
+        [&](const AnchorPair &pair) {
+          return sameSignatureByte(pair.first, candidate.first) &&
+                 sameSignatureByte(pair.second, candidate.second) &&
+                 pair.distance == distance && pair.phase == candidate.phase;
+        });
+    if (it == prefilter.pairs.end()) {
+      if (prefilter.pairs.size() == kMaxPrefilterPairs) return false;
+      prefilter.pairs.push_back(candidate);
+      it = prefilter.pairs.end() - 1;
     }
+    it->patterns.push_back(index);
+    prefilter.maxDistance = std::max(prefilter.maxDistance, distance);
+  }
+  return !prefilter.pairs.empty();
+}
+
+// maxMatches == 1 resolves the first match only; larger limits keep counting
+// each pattern and remember its lowest addresses. Only matches starting at a
+// multiple of alignment, a power of two, are counted at all.
+struct ScanLimits {
+  size_t maxMatches = 1;
+  size_t maxAddresses = 1;
+  size_t alignment = 1;
+};
 
-    if (!patterns.empty()) {
-      const auto compiled = compilePatterns(patterns, results);
-      scanCompiledPatterns(module.regions, compiled, results);
+struct ScanState {
+  const std::vector<CompiledPattern> &patterns;
+  std::vector<uintptr_t> found;
+  std::vector<bool> active;
+  size_t unresolved = 0;
+  ScanLimits limits;
+  std::vector<size_t> counts;
+  std::vector<std::vector<uintptr_t>> addresses;
+  uintptr_t ownedEnd = UINTPTR_MAX;
+  uint64_t bytesScanned = 0;
+  uint64_t candidates = 0;
+  uint64_t rejected = 0;
+  size_t matcherStates = 0;
+
+  ScanState(const std::vector<CompiledPattern> &compiled, ScanLimits scanLimits)
+      : patterns(compiled), found(compiled.size(), 0),
+        active(compiled.size(), true), unresolved(compiled.size()),
+        limits(scanLimits) {
+    if (limits.maxMatches > 1) {
+      counts.assign(compiled.size(), 0);
+      addresses.resize(compiled.size());
     }
   }
 
-  std::unique_lock lock(cacheMutex);
+  void tryMatch(const MemoryRegion &region, const uint8_t *data,
+                size_t regionSize, size_t anchorOffset, size_t patternIndex) {
+    if (!active[patternIndex]) return;
+    ++candidates;
+    const auto &pattern = *patterns[patternIndex].pattern;
+    if (regionSize < pattern.bytes.size() ||
+        anchorOffset < pattern.anchorIndex ||
+        ((region.start + anchorOffset - pattern.anchorIndex) &
+         (limits.alignment - 1)) != 0 ||
+        !matchesAnchorAt(data, regionSize, anchorOffset, pattern)) {
+      ++rejected;
+      return;
+    }
+
+    const size_t candidateOffset = anchorOffset - pattern.anchorIndex;
+    if (candidateOffset > regionSize - pattern.bytes.size() ||
+        !matchesPatternAt(data + candidateOffset, pattern)) {
+      ++rejected;
+      return;
+    }
+
+    const uintptr_t address = region.start + candidateOffset;
+    if (address >= ownedEnd) return;
+    if (found[patternIndex] == 0) found[patternIndex] = address;
+    if (limits.maxMatches > 1) {
+      if (addresses[patternIndex].size() < limits.maxAddresses) {
+        addresses[patternIndex].push_back(address);
+      }
+      if (++counts[patternIndex] < limits.maxMatches) return;
+    }
+    active[patternIndex] = false;
+    --unresolved;
+  }
+};
+
+void scanMaskedAt(const MemoryRegion &region, const uint8_t *data,
+                  size_t regionSize, size_t offset,
+                  const MaskedAnchorIndex &maskedAnchors,
+                  ScanState &state) {
+  const uint8_t value = data[offset];
+  for (uint32_t i = maskedAnchors.begin[value];
+       i < maskedAnchors.begin[value + 1]; ++i) {
+    state.tryMatch(region, data, regionSize, offset, maskedAnchors.patterns[i]);
+  }
+  if (maskedAnchors.pairBegin.empty() || offset + 1 >= regionSize) return;
+
+  const size_t key = value | (static_cast<size_t>(data[offset + 1]) << 8);
+  for (uint32_t i = maskedAnchors.pairBegin[key];
+       i < maskedAnchors.pairBegin[key + 1]; ++i) {
+    state.tryMatch(region, data, regionSize, offset,
+                   maskedAnchors.pairPatterns[i]);
+  }
+}
+
+void scanRegionCompact(const MemoryRegion &region,
+                       const CompactAutomaton &automaton,
+                       const MaskedAnchorIndex &maskedAnchors,
+                       ScanState &state) {
+  const auto *data = reinterpret_cast<const uint8_t *>(region.start);
+  const size_t regionSize = region.end - region.start;
+  const size_t classCount = automaton.classCount;
+  size_t node = 0;
+
+  for (size_t offset = 0; offset < regionSize && state.unresolved != 0;
+       ++offset) {
+    node = automaton.next[node * classCount +
+                          automaton.byteClass[data[offset]]];
+    for (uint32_t i = automaton.outputBegin[node];
+         i < automaton.outputBegin[node + 1]; ++i) {
+      const size_t patternIndex = automaton.outputs[i];
+      const auto anchorSize = state.patterns[patternIndex].pattern->anchorSize;
+      if (offset + 1 >= anchorSize) {
+        state.tryMatch(region, data, regionSize, offset + 1 - anchorSize,
+                       patternIndex);
+      }
+    }
+    scanMaskedAt(region, data, regionSize, offset, maskedAnchors, state);
+  }
+}
+
+void scanRegionShiftAnd(const MemoryRegion &region,
+                        const ShiftAndMatcher &matcher,
+                        const MaskedAnchorIndex &maskedAnchors,
+                        ScanState &state) {
+  const auto *data = reinterpret_cast<const uint8_t *>(region.start);
+  const size_t regionSize = region.end - region.start;
+  uint64_t bits = 0;
+
+  for (size_t offset = 0; offset < regionSize && state.unresolved != 0;
+       ++offset) {
+    bits = ((bits << 1) | matcher.starts) & matcher.masks[data[offset]];
+    for (uint64_t hits = bits & matcher.accepts; hits != 0;
+         hits &= hits - 1) {
+      const size_t patternIndex = matcher.patternAt[__builtin_ctzll(hits)];
+      const auto anchorSize = state.patterns[patternIndex].pattern->anchorSize;
+      state.tryMatch(region, data, regionSize, offset + 1 - anchorSize,
+                     patternIndex);
+    }
+    scanMaskedAt(region, data, regionSize, offset, maskedAnchors, state);
+  }
+}
+
+void scanRegionAutomaton(const MemoryRegion &region,
+                         const std::vector<AnchorNode> &nodes,
+                         const MaskedAnchorIndex &maskedAnchors,
+                         ScanState &state) {
+  const auto *data = reinterpret_cast<const uint8_t *>(region.start);
+  const size_t regionSize = region.end - region.start;
+  int node = 0;
+
+  for (size_t offset = 0; offset < regionSize && state.unresolved != 0;
+       ++offset) {
+    node = nodes[node].next[data[offset]];
+    for (const size_t patternIndex : nodes[node].outputs) {
+      const auto anchorSize = state.patterns[patternIndex].pattern->anchorSize;
+      if (offset + 1 >= anchorSize) {
+        state.tryMatch(region, data, regionSize, offset + 1 - anchorSize,
+                       patternIndex);
+      }
+    }
+
+    scanMaskedAt(region, data, regionSize, offset, maskedAnchors, state);
+  }
+}
+
+// Lanes of a block at which an anchor with the given phase can start an
+// aligned match. Blocks start at multiples of kSimdWidth, so one mask serves
+// the whole region.
+LaneMask alignedLaneMask(uintptr_t regionStart, size_t phase,
+                         size_t alignment) {
+  if (alignment <= 1 || alignment > kSimdWidth) return ~LaneMask{0};
+  constexpr LaneMask laneBits = (LaneMask{1} << (1 << kLaneShift)) - 1;
+  LaneMask mask = 0;
+  for (size_t lane = (phase - regionStart) & (alignment - 1);
+       lane < kSimdWidth; lane += alignment) {
+    mask |= laneBits << (lane << kLaneShift);
+  }
+  return mask;
+}
+
+void scanRegionPrefiltered(const MemoryRegion &region,
+                           const AnchorPrefilter &prefilter,
+                           ScanState &state) {
+  const auto *data = reinterpret_cast<const uint8_t *>(region.start);
+  const size_t regionSize = region.end - region.start;
+  size_t offset = 0;
+
+  std::array<LaneMask, kMaxPrefilterPairs> laneMasks{};
+  for (size_t i = 0; i < prefilter.pairs.size(); ++i) {
+    laneMasks[i] = alignedLaneMask(region.start, prefilter.pairs[i].phase,
+                                   state.limits.alignment);
+  }
+
+  if (regionSize >= kSimdWidth + prefilter.maxDistance) {
+    const size_t lastBlock = regionSize - kSimdWidth - prefilter.maxDistance;
+    for (; offset <= lastBlock && state.unresolved != 0;
+         offset += kSimdWidth) {
+      for (size_t i = 0; i < prefilter.pairs.size(); ++i) {
+        const auto &pair = prefilter.pairs[i];
+        LaneMask mask = matchPairMask(data + offset, pair) & laneMasks[i];
+        while (mask != 0) {
+          const size_t anchorOffset = offset + nextLane(mask);
+          for (const size_t patternIndex : pair.patterns) {
+            state.tryMatch(region, data, regionSize, anchorOffset,
+                           patternIndex);
+          }
+        }
+      }
+    }
+  }
+
+  for (; offset < regionSize && state.unresolved != 0; ++offset) {
+    for (const auto &pair : prefilter.pairs) {
+      if (!matches(pair.first, data[offset]) ||
+          offset + pair.distance >= regionSize ||
+          !matches(pair.second, data[offset + pair.distance])) {
+        continue;
+      }
+      for (const size_t patternIndex : pair.patterns) {
+        state.tryMatch(region, data, regionSize, offset, patternIndex);
+      }
+    }
+  }
+}
+
+// Bucketed nibble filter for batches past a couple of prefilter pairs, in
+// the style of Teddy: every pattern contributes a fingerprint of
+// kFingerprintSize consecutive bytes to one of eight buckets, and per
+// fingerprint byte two 16-entry tables give the buckets its low and its high
+// nibble allow. One shuffle per nibble tests a whole block against every
+// bucket at once, so the cost per byte no longer grows with the batch; the
+// patterns of a bucket that fires are verified one by one.
+#if defined(__AVX2__) || defined(__SSSE3__) || defined(__ARM_NEON)
+constexpr bool kHasByteShuffle = true;
+#else
+constexpr bool kHasByteShuffle = false;
+#endif
+
+constexpr size_t kFingerprintSize = 4;
+constexpr size_t kFilterBuckets = 8;
+// Past two patterns a bucket the nibble tables stop telling patterns apart,
+// and the hashed filter below is faster where it applies.
+constexpr size_t kMaxBucketedPatterns = 2 * kFilterBuckets;
+// Expected verifications per scanned byte, weighted by code byte frequency,
+// above which the automaton is cheaper than the filter.
+constexpr double kMaxBucketCandidateRate = 1.0 / 32;
+
+struct BucketEntry {
+  size_t pattern = 0;
+  size_t fingerprintIndex = 0;
+};
+
+struct BucketedFilter {
+  std::array<std::array<uint8_t, 16>, kFingerprintSize> low{};
+  std::array<std::array<uint8_t, 16>, kFingerprintSize> high{};
+  std::array<std::vector<BucketEntry>, kFilterBuckets> buckets;
+};
+
+// Start of the pattern's most selective fingerprint window.
+size_t selectFingerprint(const ParsedPattern &pattern) {
+  size_t best = pattern.anchorIndex;
+  int bestScore = -1;
+  for (size_t start = 0; start + kFingerprintSize <= pattern.bytes.size();
+       ++start) {
+    int score = 0;
+    for (size_t i = 0; i < kFingerprintSize; ++i) {
+      score += detail::byteRarity(pattern.bytes[start + i]);
+    }
+    if (score > bestScore) {
+      best = start;
+      bestScore = score;
+    }
+  }
+  return best;
+}
+
+bool buildBucketedFilter(const std::vector<CompiledPattern> &patterns,
+                         const std::vector<bool> &active,
+                         BucketedFilter &filter) {
+  if (!kHasByteShuffle) return false;
+
+  std::vector<BucketEntry> entries;
+  for (size_t index = 0; index < patterns.size(); ++index) {
+    if (!active[index]) continue;
+    const auto &pattern = *patterns[index].pattern;
+    if (pattern.bytes.size() < kFingerprintSize) return false;
+    entries.push_back(BucketEntry{index, selectFingerprint(pattern)});
+  }
+  if (entries.empty()) return false;
+
+  // Neighbours in fingerprint order share the most nibbles, so contiguous
+  // runs make the tightest buckets.
+  const auto fingerprintByte = [&](const BucketEntry &entry, size_t i) {
+    const auto byte =
+        patterns[entry.pattern].pattern->bytes[entry.fingerprintIndex + i];
+    return std::pair{byte.mask, byte.value};
+  };
+  std::sort(entries.begin(), entries.end(),
+            [&](const BucketEntry &left, const BucketEntry &right) {
+              for (size_t i = 0; i < kFingerprintSize; ++i) {
+                const auto l = fingerprintByte(left, i);
+                const auto r = fingerprintByte(right, i);
+                if (l != r) return l < r;
+              }
+              return false;
+            });
+
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const size_t bucket = i * kFilterBuckets / entries.size();
+    filter.buckets[bucket].push_back(entries[i]);
+    const uint8_t bit = static_cast<uint8_t>(1u << bucket);
+    for (size_t k = 0; k < kFingerprintSize; ++k) {
+      const auto [mask, value] = fingerprintByte(entries[i], k);
+      for (uint8_t nibble = 0; nibble < 16; ++nibble) {
+        if ((nibble & mask & 0xF) == (value & 0xF)) {
+          filter.low[k][nibble] |= bit;
+        }
+        if ((nibble & mask >> 4) == value >> 4) filter.high[k][nibble] |= bit;
+      }
+    }
+  }
+
+  double rate = 0;
+  for (size_t bucket = 0; bucket < kFilterBuckets; ++bucket) {
+    double passing = 1;
+    for (size_t k = 0; k < kFingerprintSize; ++k) {
+      uint32_t hits = 0;
+      for (uint32_t value = 0; value < 256; ++value) {
+        if (filter.low[k][value & 0xF] & filter.high[k][value >> 4] &
+            (1u << bucket)) {
+          hits += detail::kCodeByteFrequency[value];
+        }
+      }
+      passing *= hits / 65536.0;
+    }
+    rate += passing * static_cast<double>(filter.buckets[bucket].size());
+  }
+  if (rate > kMaxBucketCandidateRate) {
+    filter = BucketedFilter{};
+    return false;
+  }
+  return true;
+}
+
+// Buckets allowed at each of the kSimdWidth positions from data, stored to
+// buckets; returns the lanes where any is.
+LaneMask matchBuckets(const uint8_t *data, const BucketedFilter &filter,
+                      uint8_t *buckets) {
+#if defined(__AVX2__)
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  __m256i hits = _mm256_set1_epi8(-1);
+  for (size_t k = 0; k < kFingerprintSize; ++k) {
+    const __m256i bytes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + k));
+    const __m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(filter.low[k].data())));
+    const __m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(filter.high[k].data())));
+    hits = _mm256_and_si256(
+        hits,
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(low, _mm256_and_si256(bytes, nibble)),
+            _mm256_shuffle_epi8(
+                high, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble))));
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(buckets), hits);
+  return ~static_cast<LaneMask>(_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(hits, _mm256_setzero_si256())));
+#elif defined(__SSSE3__)
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  __m128i hits = _mm_set1_epi8(-1);
+  for (size_t k = 0; k < kFingerprintSize; ++k) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + k));
+    const __m128i low = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(filter.low[k].data()));
+    const __m128i high = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(filter.high[k].data()));
+    hits = _mm_and_si128(
+        hits, _mm_and_si128(
+                  _mm_shuffle_epi8(low, _mm_and_si128(bytes, nibble)),
+                  _mm_shuffle_epi8(
+                      high, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble))));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(buckets), hits);
+  return ~static_cast<LaneMask>(_mm_movemask_epi8(
+             _mm_cmpeq_epi8(hits, _mm_setzero_si128()))) &
+         0xFFFF;
+#elif defined(__ARM_NEON)
+  const uint8x16_t nibble = vdupq_n_u8(0x0F);
+  uint8x16_t hits = vdupq_n_u8(0xFF);
+  // AArch32 has no 16-byte table lookup, only two 8-byte halves.
+  const auto lookup = [](const std::array<uint8_t, 16> &table,
+                         uint8x16_t indices) {
+#if defined(__aarch64__)
+    return vqtbl1q_u8(vld1q_u8(table.data()), indices);
+#else
+    const uint8x8x2_t halves = {{vld1_u8(table.data()),
+                                 vld1_u8(table.data() + 8)}};
+    return vcombine_u8(vtbl2_u8(halves, vget_low_u8(indices)),
+                       vtbl2_u8(halves, vget_high_u8(indices)));
+#endif
+  };
+  for (size_t k = 0; k < kFingerprintSize; ++k) {
+    const uint8x16_t bytes = vld1q_u8(data + k);
+    hits = vandq_u8(hits,
+                    vandq_u8(lookup(filter.low[k], vandq_u8(bytes, nibble)),
+                             lookup(filter.high[k], vshrq_n_u8(bytes, 4))));
+  }
+  vst1q_u8(buckets, hits);
+  // Narrow every lane that has a bucket to one nibble of a 64-bit mask.
+  const uint8x16_t any = vtstq_u8(hits, hits);
+  const uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(any), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+#else
+  (void)data;
+  (void)filter;
+  (void)buckets;
+  return 0;
+#endif
+}
+
+void tryBuckets(const MemoryRegion &region, const uint8_t *data,
+                size_t regionSize, size_t offset, uint8_t buckets,
+                const BucketedFilter &filter, ScanState &state) {
+  for (; buckets != 0; buckets &= buckets - 1) {
+    for (const auto &entry : filter.buckets[std::countr_zero(buckets)]) {
+      if (offset < entry.fingerprintIndex) continue;
+      state.tryMatch(region, data, regionSize,
+                     offset - entry.fingerprintIndex +
+                         state.patterns[entry.pattern].pattern->anchorIndex,
+                     entry.pattern);
+    }
+  }
+}
+
+void scanRegionBucketed(const MemoryRegion &region,
+                        const BucketedFilter &filter, ScanState &state) {
+  const auto *data = reinterpret_cast<const uint8_t *>(region.start);
+  const size_t regionSize = region.end - region.start;
+  size_t offset = 0;
+
+  if (regionSize >= kSimdWidth + kFingerprintSize - 1) {
+    const size_t lastBlock = regionSize - kSimdWidth - (kFingerprintSize - 1);
+    std::array<uint8_t, kSimdWidth> buckets{};
+    for (; offset <= lastBlock && state.unresolved != 0;
+         offset += kSimdWidth) {
+      LaneMask mask = matchBuckets(data + offset, filter, buckets.data());
+      while (mask != 0) {
+        const size_t lane = nextLane(mask);
+        tryBuckets(region, data, regionSize, offset + lane, buckets[lane],
+                   filter, state);
+      }
+    }
+  }
+
+  for (; offset < regionSize && state.unresolved != 0; ++offset) {
+    uint8_t buckets = offset + kFingerprintSize <= regionSize ? 0xFF : 0;
+    for (size_t k = 0; k < kFingerprintSize && buckets != 0; ++k) {
+      const uint8_t value = data[offset + k];
+      buckets &= filter.low[k][value & 0xF] & filter.high[k][value >> 4];
+    }
+    tryBuckets(region, data, regionSize, offset, buckets, filter, state);
+  }
+}
+
+// Hashed fingerprint filter for batches the buckets cannot keep apart, in
+// the style of Rabin-Karp: every pattern contributes windows of kHashWindow
+// bytes read under a mask its group shares, and the scan hashes the window
+// at every stride-th offset and tests one bit of a bitmap small enough for
+// L1. A pattern adds the stride windows that start at consecutive offsets,
+// so one of them lands on a sampled offset wherever it matches. Hits are
+// looked up in the group's sorted keys and verified. The cost per byte does
+// not grow with the batch, and nibble masks hash as cheaply as exact bytes.
+constexpr size_t kHashWindow = 8;
+constexpr size_t kMaxHashStride = 8;
+constexpr size_t kMaxHashGroups = 3;
+// Group masks are picked from this many of the most common window masks.
+constexpr size_t kMaxHashMaskCandidates = 8;
+constexpr int kMinHashMaskBits = 16;
+constexpr size_t kHashBitsPerKey = 32;
+constexpr size_t kMinHashTableBits = 10;
+constexpr size_t kMaxHashTableBits = 18;
+// Expected lookups per scanned byte, from true window hits weighted by code
+// byte frequency and from bitmap collisions.
+constexpr double kMaxHashCandidateRate = 1.0 / 16;
+constexpr uint64_t kHashMultiplier = 0x9E3779B97F4A7C15ull;
+
+struct HashEntry {
+  uint64_t key = 0;
+  size_t pattern = 0;
+  size_t windowIndex = 0;
+};
+
+struct HashGroup {
+  uint64_t mask = 0;
+  size_t stride = 1;
+  int shift = 0;
+  std::vector<uint64_t> bitmap;
+  // By key, then pattern, then windowIndex descending, so the windows of one
+  // pattern that hit at the same offset are tried lowest match first.
+  std::vector<HashEntry> entries;
+};
+
+struct HashedFilter {
+  std::vector<HashGroup> groups;
+};
+
+// Mask and masked value of every window of the pattern, in the byte order of
+// the text; a pattern shorter than a window has one, masked past its end.
+void collectHashWindows(const ParsedPattern &pattern,
+                        std::vector<uint64_t> &masks,
+                        std::vector<uint64_t> &values) {
+  const size_t count = pattern.bytes.size() >= kHashWindow
+                           ? pattern.bytes.size() - kHashWindow + 1
+                           : 1;
+  masks.resize(count);
+  values.resize(count);
+  for (size_t start = 0; start < count; ++start) {
+    uint8_t mask[kHashWindow] = {};
+    uint8_t value[kHashWindow] = {};
+    for (size_t i = 0; i < kHashWindow && start + i < pattern.bytes.size();
+         ++i) {
+      mask[i] = pattern.bytes[start + i].mask;
+      value[i] = pattern.bytes[start + i].value;
+    }
+    std::memcpy(&masks[start], mask, sizeof(mask));
+    std::memcpy(&values[start], value, sizeof(value));
+  }
+}
+
+bool buildHashedFilter(const std::vector<CompiledPattern> &patterns,
+                       const std::vector<bool> &active, HashedFilter &filter) {
+  // Rarity of a window's bytes under a mask, in quarter bits.
+  std::unordered_map<uint32_t, int> rarities;
+  const auto windowRarity = [&rarities](uint64_t mask, uint64_t value) {
+    int score = 0;
+    for (size_t i = 0; i < kHashWindow; ++i, mask >>= 8, value >>= 8) {
+      const auto byteMask = static_cast<uint8_t>(mask);
+      const auto byteValue = static_cast<uint8_t>(value & byteMask);
+      const auto [it, inserted] =
+          rarities.try_emplace(uint32_t{byteMask} << 8 | byteValue, 0);
+      if (inserted) {
+        it->second = detail::byteRarity(SignatureByte{byteValue, byteMask});
+      }
+      score += it->second;
+    }
+    return score;
+  };
+
+  struct Windows {
+    size_t pattern = 0;
+    std::vector<uint64_t> masks;
+    std::vector<uint64_t> values;
+  };
+  std::vector<Windows> pending;
+  std::unordered_map<uint64_t, size_t> maskCounts;
+  for (size_t index = 0; index < patterns.size(); ++index) {
+    if (!active[index]) continue;
+    auto &windows = pending.emplace_back();
+    windows.pattern = index;
+    collectHashWindows(*patterns[index].pattern, windows.masks,
+                       windows.values);
+    size_t best = 0;
+    int bestScore = -1;
+    for (size_t start = 0; start < windows.masks.size(); ++start) {
+      const int score =
+          windowRarity(windows.masks[start], windows.values[start]);
+      if (score > bestScore) {
+        best = start;
+        bestScore = score;
+      }
+    }
+    if (std::popcount(windows.masks[best]) >= kMinHashMaskBits) {
+      ++maskCounts[windows.masks[best]];
+    }
+  }
+  if (pending.empty()) return false;
+
+  std::vector<std::pair<size_t, uint64_t>> candidates;
+  for (const auto &[mask, count] : maskCounts) {
+    candidates.emplace_back(count, mask);
+  }
+  std::sort(candidates.begin(), candidates.end(), std::greater<>());
+  if (candidates.size() > kMaxHashMaskCandidates) {
+    candidates.resize(kMaxHashMaskCandidates);
+  }
+
+  // Longest run of consecutive windows that know every bit of mask, up to
+  // kMaxHashStride, and where the rarest such run starts.
+  const auto findRun = [&](const Windows &windows, uint64_t mask,
+                           size_t stride, size_t &runStart) {
+    size_t longest = 0;
+    size_t length = 0;
+    int bestScore = -1;
+    for (size_t start = 0; start < windows.masks.size(); ++start) {
+      length = (mask & ~windows.masks[start]) == 0 ? length + 1 : 0;
+      longest = std::max(longest, std::min(length, kMaxHashStride));
+      if (stride == 0 || length < stride) continue;
+      const size_t first = start + 1 - stride;
+      const int score = windowRarity(mask, windows.values[first]);
+      if (score > bestScore) {
+        runStart = first;
+        bestScore = score;
+      }
+    }
+    return longest;
+  };
+
+  // Greedy cover: each group takes the mask and stride that sample the
+  // fewest offsets for the patterns still without a group, weighing how
+  // many it covers against how far it strides.
+  double rate = 0;
+  while (!pending.empty()) {
+    if (filter.groups.size() == kMaxHashGroups) {
+      filter = HashedFilter{};
+      return false;
+    }
+    uint64_t bestMask = 0;
+    size_t bestStride = 0;
+    size_t bestScore = 0;
+    for (const auto &[count, mask] : candidates) {
+      size_t unused = 0;
+      std::array<size_t, kMaxHashStride + 1> runs{};
+      for (const auto &windows : pending) {
+        ++runs[findRun(windows, mask, 0, unused)];
+      }
+      size_t covered = 0;
+      for (size_t stride = kMaxHashStride; stride >= 1; --stride) {
+        covered += runs[stride];
+        if (covered * stride > bestScore) {
+          bestMask = mask;
+          bestStride = stride;
+          bestScore = covered * stride;
+        }
+      }
+    }
+    if (bestScore == 0) {
+      filter = HashedFilter{};
+      return false;
+    }
+
+    auto &group = filter.groups.emplace_back();
+    group.mask = bestMask;
+    group.stride = bestStride;
+    std::erase_if(pending, [&](const Windows &windows) {
+      size_t start = 0;
+      if (findRun(windows, group.mask, group.stride, start) < group.stride) {
+        return false;
+      }
+      for (size_t i = 0; i < group.stride; ++i) {
+        group.entries.push_back(HashEntry{
+            windows.values[start + i] & group.mask, windows.pattern,
+            start + i});
+        rate += std::exp2(-windowRarity(group.mask,
+                                        windows.values[start + i]) /
+                          4.0) /
+                static_cast<double>(group.stride);
+      }
+      return true;
+    });
+
+    const size_t tableBits =
+        std::clamp<size_t>(std::bit_width(group.entries.size() *
+                                          kHashBitsPerKey - 1),
+                           kMinHashTableBits, kMaxHashTableBits);
+    group.shift = static_cast<int>(64 - tableBits);
+    group.bitmap.assign((size_t{1} << tableBits) / 64, 0);
+    for (const auto &entry : group.entries) {
+      const uint64_t slot = (entry.key * kHashMultiplier) >> group.shift;
+      group.bitmap[slot / 64] |= uint64_t{1} << (slot % 64);
+    }
+    std::sort(group.entries.begin(), group.entries.end(),
+              [](const HashEntry &left, const HashEntry &right) {
+                if (left.key != right.key) return left.key < right.key;
+                if (left.pattern != right.pattern) {
+                  return left.pattern < right.pattern;
+                }
+                return left.windowIndex > right.windowIndex;
+              });
+    rate += static_cast<double>(group.entries.size()) /
+            static_cast<double>(size_t{1} << tableBits) /
+            static_cast<double>(group.stride);
+  }
+  if (rate > kMaxHashCandidateRate) {
+    filter = HashedFilter{};
+    return false;
+  }
+  return true;
+}
+
+void tryHashGroup(const MemoryRegion &region, const uint8_t *data,
+                  size_t regionSize, size_t offset, uint64_t key,
+                  const HashGroup &group, ScanState &state) {
+  const auto hits = std::equal_range(
+      group.entries.begin(), group.entries.end(), HashEntry{key},
+      [](const HashEntry &left, const HashEntry &right) {
+        return left.key < right.key;
+      });
+  for (auto it = hits.first; it != hits.second; ++it) {
+    if (offset < it->windowIndex) continue;
+    state.tryMatch(region, data, regionSize,
+                   offset - it->windowIndex +
+                       state.patterns[it->pattern].pattern->anchorIndex,
+                   it->pattern);
+  }
+}
+
+// Every pattern belongs to one group, so scanning group after group still
+// meets the matches of each pattern in address order. A pass keeps its
+// mask, stride and bitmap in registers.
+void scanRegionHashed(const MemoryRegion &region, const HashedFilter &filter,
+                      ScanState &state) {
+  constexpr size_t kBlock = 512;
+  const auto *data = reinterpret_cast<const uint8_t *>(region.start);
+  const size_t regionSize = region.end - region.start;
+  const size_t fullWindows =
+      regionSize >= kHashWindow ? regionSize - kHashWindow + 1 : 0;
+  for (const auto &group : filter.groups) {
+    const uint64_t mask = group.mask;
+    const size_t stride = group.stride;
+    const int shift = group.shift;
+    const uint64_t *bitmap = group.bitmap.data();
+    size_t offset = 0;
+    while (offset < fullWindows && state.unresolved != 0) {
+      const size_t blockEnd = std::min(fullWindows, offset + kBlock);
+      for (; offset < blockEnd; offset += stride) {
+        uint64_t window;
+        std::memcpy(&window, data + offset, sizeof(window));
+        const uint64_t key = window & mask;
+        const uint64_t slot = (key * kHashMultiplier) >> shift;
+        if ((bitmap[slot / 64] >> (slot % 64) & 1) != 0) {
+          tryHashGroup(region, data, regionSize, offset, key, group, state);
+        }
+      }
+    }
+    // The last windows run past the region; the bytes there read as zero,
+    // and only patterns shorter than a window leave them unmasked.
+    for (; offset < regionSize && state.unresolved != 0; offset += stride) {
+      uint64_t window = 0;
+      std::memcpy(&window, data + offset, regionSize - offset);
+      tryHashGroup(region, data, regionSize, offset, window & mask, group,
+                   state);
+    }
+  }
+}
+
+struct ScanMatcher {
+  ScanEngine engine = ScanEngine::Automaton;
+  MaskedAnchorIndex maskedAnchors;
+  AnchorPrefilter prefilter;
+  BucketedFilter bucketed;
+  HashedFilter hashed;
+  ShiftAndMatcher shiftAnd;
+  CompactAutomaton compact;
+  std::vector<AnchorNode> nodes;
+};
+
+bool hasMaskedAnchors(const std::vector<CompiledPattern> &patterns,
+                      const std::vector<bool> &active) {
+  for (size_t index = 0; index < patterns.size(); ++index) {
+    if (active[index] && !hasExactAnchor(*patterns[index].pattern)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The automaton stays the reference path; the other engines are picked from
+// the cheapest one that can represent the active anchors. Batches with masked
+// anchors go to the hashed filter first: a masked nibble leaves half of each
+// nibble table open.
+void buildScanMatcher(const std::vector<CompiledPattern> &patterns,
+                      const std::vector<bool> &active, size_t alignment,
+                      ScanMatcher &matcher) {
+  const bool masked = hasMaskedAnchors(patterns, active);
+  const bool prefiltered =
+      buildAnchorPrefilter(patterns, active, alignment, matcher.prefilter);
+  if (prefiltered &&
+      matcher.prefilter.pairs.size() <=
+          (masked ? kPreferredMaskedPrefilterPairs
+                  : kPreferredPrefilterPairs)) {
+    matcher.engine = ScanEngine::Prefilter;
+  } else if (!masked &&
+             static_cast<size_t>(std::ranges::count(active, true)) <=
+                 kMaxBucketedPatterns &&
+             buildBucketedFilter(patterns, active, matcher.bucketed)) {
+    matcher.engine = ScanEngine::Bucketed;
+  } else if (buildHashedFilter(patterns, active, matcher.hashed)) {
+    matcher.engine = ScanEngine::Hashed;
+  } else if (buildBucketedFilter(patterns, active, matcher.bucketed)) {
+    matcher.engine = ScanEngine::Bucketed;
+  } else if (prefiltered) {
+    matcher.engine = ScanEngine::Prefilter;
+  } else {
+    // Only the byte-at-a-time engines below test masked anchors on their
+    // own; the index keys every accepted value pair, so it is built last.
+    matcher.maskedAnchors = buildMaskedAnchorIndex(patterns, active);
+    if (buildShiftAndMatcher(patterns, active, matcher.shiftAnd)) {
+      matcher.engine = ScanEngine::ShiftAnd;
+    } else if (buildCompactAutomaton(patterns, active, matcher.compact)) {
+      matcher.engine = ScanEngine::Compact;
+    } else {
+      matcher.engine = ScanEngine::Automaton;
+      matcher.nodes = buildAnchorAutomaton(patterns, active);
+    }
+  }
+}
+
+// Builds engine alone, false when it cannot hold the active anchors or its
+// filter would pass too many candidates.
+bool buildScanMatcher(const std::vector<CompiledPattern> &patterns,
+                      const std::vector<bool> &active, size_t alignment,
+                      ScanEngine engine, ScanMatcher &matcher) {
+  matcher.engine = engine;
+  switch (engine) {
+  case ScanEngine::Prefilter:
+    return buildAnchorPrefilter(patterns, active, alignment,
+                                matcher.prefilter);
+  case ScanEngine::Bucketed:
+    return buildBucketedFilter(patterns, active, matcher.bucketed);
+  case ScanEngine::Hashed:
+    return buildHashedFilter(patterns, active, matcher.hashed);
+  case ScanEngine::ShiftAnd:
+    matcher.maskedAnchors = buildMaskedAnchorIndex(patterns, active);
+    return buildShiftAndMatcher(patterns, active, matcher.shiftAnd);
+  case ScanEngine::Compact:
+    matcher.maskedAnchors = buildMaskedAnchorIndex(patterns, active);
+    return buildCompactAutomaton(patterns, active, matcher.compact);
+  case ScanEngine::Automaton:
+    matcher.maskedAnchors = buildMaskedAnchorIndex(patterns, active);
+    matcher.nodes = buildAnchorAutomaton(patterns, active);
+    return true;
+  }
+  return false;
+}
+
+void scanRegion(const MemoryRegion &region, const ScanMatcher &matcher,
+                ScanState &state) {
+  state.bytesScanned += region.end - region.start;
+  switch (matcher.engine) {
+  case ScanEngine::Prefilter:
+    scanRegionPrefiltered(region, matcher.prefilter, state);
+    break;
+  case ScanEngine::Bucketed:
+    scanRegionBucketed(region, matcher.bucketed, state);
+    break;
+  case ScanEngine::Hashed:
+    scanRegionHashed(region, matcher.hashed, state);
+    break;
+  case ScanEngine::ShiftAnd:
+    scanRegionShiftAnd(region, matcher.shiftAnd, matcher.maskedAnchors,
+                       state);
+    break;
+  case ScanEngine::Compact:
+    scanRegionCompact(region, matcher.compact, matcher.maskedAnchors, state);
+    break;
+  case ScanEngine::Automaton:
+    scanRegionAutomaton(region, matcher.nodes, matcher.maskedAnchors, state);
+    break;
+  }
+}
+
+// Size of the engine's state machine: prefilter pairs, filter buckets, hash
+// groups, Shift-And positions or automaton states.
+size_t countMatcherStates(const ScanMatcher &matcher) {
+  switch (matcher.engine) {
+  case ScanEngine::Prefilter:
+    return matcher.prefilter.pairs.size();
+  case ScanEngine::Bucketed:
+    return static_cast<size_t>(std::ranges::count_if(
+        matcher.bucketed.buckets,
+        [](const auto &bucket) { return !bucket.empty(); }));
+  case ScanEngine::Hashed:
+    return matcher.hashed.groups.size();
+  case ScanEngine::ShiftAnd:
+    return std::bit_width(matcher.shiftAnd.accepts);
+  case ScanEngine::Compact:
+    return matcher.compact.next.size() / matcher.compact.classCount;
+  case ScanEngine::Automaton:
+    return matcher.nodes.size();
+  }
+  return 0;
+}
+
+bool readCpuMaxFrequency(size_t cpu, unsigned long &frequency) {
+  char path[96];
+  std::snprintf(path, sizeof(path),
+                "/sys/devices/system/cpu/cpu%zu/cpufreq/cpuinfo_max_freq",
+                cpu);
+  FILE *file = std::fopen(path, "r");
+  if (!file) return false;
+  const bool ok = std::fscanf(file, "%lu", &frequency) == 1;
+  std::fclose(file);
+  return ok;
+}
+
+size_t countBigCores() {
+  const size_t cpuCount = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<unsigned long> frequencies;
+  frequencies.reserve(cpuCount);
+  for (size_t cpu = 0; cpu < cpuCount; ++cpu) {
+    unsigned long frequency = 0;
+    if (!readCpuMaxFrequency(cpu, frequency)) return cpuCount;
+    frequencies.push_back(frequency);
+  }
+
+  // Little cores share the lowest maximum clock on big.LITTLE parts; a
+  // homogeneous CPU has no little cluster and uses every core.
+  const auto [slowest, fastest] =
+      std::minmax_element(frequencies.begin(), frequencies.end());
+  if (*slowest == *fastest) return cpuCount;
+  const unsigned long littleFrequency = *slowest;
+  return static_cast<size_t>(
+      std::count_if(frequencies.begin(), frequencies.end(),
+                    [&](unsigned long frequency) {
+                      return frequency > littleFrequency;
+                    }));
+}
+
+size_t getScanWorkerCount() {
+  static const size_t workerCount = std::max<size_t>(1, countBigCores());
+  return workerCount;
+}
+
+struct ScanChunk {
+  MemoryRegion region;
+  uintptr_t ownedEnd = 0;
+};
+
+// Chunks overlap by the longest pattern so a match that starts near the end
+// of one chunk is still seen whole; only matches starting before ownedEnd
+// count for that chunk.
+std::vector<ScanChunk> splitScanChunks(const std::vector<MemoryRegion> &regions,
+                                       size_t overlap) {
+  const size_t chunkSize = std::max(kScanChunkSize, overlap * 4);
+  std::vector<ScanChunk> chunks;
+  for (const auto &region : regions) {
+    for (uintptr_t start = region.start; start < region.end;
+         start += chunkSize) {
+      const size_t remaining = region.end - start;
+      const size_t size = std::min(remaining, chunkSize + overlap);
+      const uintptr_t ownedEnd =
+          size == remaining ? region.end : start + chunkSize;
+      chunks.push_back(ScanChunk{MemoryRegion{start, start + size}, ownedEnd});
+      if (size == remaining) break;
+    }
+  }
+  return chunks;
+}
+
+void scanRegionsParallel(const std::vector<MemoryRegion> &regions,
+                         const ScanMatcher &matcher, ScanState &state,
+                         size_t workerCount) {
+  const auto &patterns = state.patterns;
+  const bool detailed = state.limits.maxMatches > 1;
+  size_t overlap = 0;
+  for (size_t i = 0; i < patterns.size(); ++i) {
+    if (state.active[i]) {
+      overlap = std::max(overlap, patterns[i].pattern->bytes.size() - 1);
+    }
+  }
+
+  const auto chunks = splitScanChunks(regions, overlap);
+  std::vector<std::atomic<uintptr_t>> best(patterns.size());
+  for (auto &address : best) address.store(UINTPTR_MAX);
+  std::atomic<size_t> nextChunk{0};
+  std::mutex mergeMutex;
+
+  auto worker = [&] {
+    ScanState local(patterns, state.limits);
+    for (size_t chunk = nextChunk.fetch_add(1); chunk < chunks.size();
+         chunk = nextChunk.fetch_add(1)) {
+      // Chunks are handed out in address order, so a first match already
+      // found in an earlier chunk lets this one skip that pattern entirely.
+      local.unresolved = 0;
+      local.ownedEnd = chunks[chunk].ownedEnd;
+      for (size_t i = 0; i < patterns.size(); ++i) {
+        local.found[i] = 0;
+        local.active[i] = state.active[i] &&
+                          (detailed || best[i].load(std::memory_order_relaxed) >
+                                           chunks[chunk].region.start);
+        if (local.active[i]) ++local.unresolved;
+        if (detailed) {
+          local.counts[i] = 0;
+          local.addresses[i].clear();
+        }
+      }
+      if (local.unresolved == 0) continue;
+
+      scanRegion(chunks[chunk].region, matcher, local);
+      if (detailed) {
+        std::lock_guard lock(mergeMutex);
+        for (size_t i = 0; i < patterns.size(); ++i) {
+          state.counts[i] = std::min(state.limits.maxMatches,
+                                     state.counts[i] + local.counts[i]);
+          state.addresses[i].insert(state.addresses[i].end(),
+                                    local.addresses[i].begin(),
+                                    local.addresses[i].end());
+        }
+      }
+      for (size_t i = 0; i < patterns.size(); ++i) {
+        if (local.found[i] == 0) continue;
+        uintptr_t current = best[i].load(std::memory_order_relaxed);
+        while (local.found[i] < current &&
+               !best[i].compare_exchange_weak(current, local.found[i],
+                                              std::memory_order_relaxed)) {
+        }
+      }
+    }
+
+    std::lock_guard lock(mergeMutex);
+    state.bytesScanned += local.bytesScanned;
+    state.candidates += local.candidates;
+    state.rejected += local.rejected;
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(workerCount - 1);
+  for (size_t i = 1; i < workerCount; ++i) {
+    try {
+      threads.emplace_back(worker);
+    } catch (const std::system_error &) {
+      break;
+    }
+  }
+  worker();
+  for (auto &thread : threads) thread.join();
+
+  for (size_t i = 0; i < patterns.size(); ++i) {
+    const uintptr_t address = best[i].load(std::memory_order_relaxed);
+    if (!state.active[i] || address == UINTPTR_MAX) continue;
+    state.found[i] = address;
+    if (detailed) {
+      // Every chunk kept its own lowest addresses, so the global lowest ones
+      // are among them.
+      auto &addresses = state.addresses[i];
+      std::sort(addresses.begin(), addresses.end());
+      if (addresses.size() > state.limits.maxAddresses) {
+        addresses.resize(state.limits.maxAddresses);
+      }
+      if (state.counts[i] < state.limits.maxMatches) continue;
+    }
+    state.active[i] = false;
+    --state.unresolved;
+  }
+}
+
+// A scan state with the patterns that check no bytes already matched at the
+// first region, which leaves only the others active for a matcher.
+ScanState startScan(const std::vector<MemoryRegion> &regions,
+                    const std::vector<CompiledPattern> &patterns,
+                    ScanLimits limits) {
+  ScanState state(patterns, limits);
+  if (patterns.empty()) return state;
+
+  if (regions.empty()) {
+    state.unresolved = 0;
+  } else {
+    for (size_t i = 0; i < patterns.size(); ++i) {
+      if (!patterns[i].pattern->checkIndices.empty()) continue;
+      state.found[i] = regions.front().start;
+      state.active[i] = false;
+      --state.unresolved;
+      if (limits.maxMatches > 1) {
+        state.counts[i] = limits.maxMatches;
+        state.addresses[i].push_back(regions.front().start);
+      }
+    }
+  }
+  return state;
+}
+
+void runScan(const std::vector<MemoryRegion> &regions,
+             const ScanMatcher &matcher, ScanState &state) {
+  state.matcherStates = countMatcherStates(matcher);
+
+  size_t totalBytes = 0;
+  for (const auto &region : regions) totalBytes += region.end - region.start;
+  const size_t workerCount = getScanWorkerCount();
+
+  if (state.unresolved != 0 && workerCount > 1 &&
+      totalBytes >= kMinParallelScanBytes) {
+    scanRegionsParallel(regions, matcher, state, workerCount);
+  } else {
+    for (const auto &region : regions) {
+      if (state.unresolved == 0) break;
+      scanRegion(region, matcher, state);
+    }
+  }
+}
+
+ScanState scanPatterns(const std::vector<MemoryRegion> &regions,
+                       const std::vector<CompiledPattern> &patterns,
+                       ScanLimits limits) {
+  ScanState state = startScan(regions, patterns, limits);
+  if (patterns.empty()) return state;
+
+  ScanMatcher matcher;
+  buildScanMatcher(patterns, state.active, limits.alignment, matcher);
+  runScan(regions, matcher, state);
+  return state;
+}
+
+void addScanStats(SignatureStats &stats, const ScanState &state) {
+  stats.bytesScanned += state.bytesScanned;
+  stats.matcherStates += state.matcherStates;
+  stats.candidates += state.candidates;
+  stats.verificationFailures += state.rejected;
+}
+
+void scanCompiledPatterns(const std::vector<MemoryRegion> &regions,
+                          const std::vector<CompiledPattern> &patterns,
+                          size_t alignment, std::span<uintptr_t> addresses,
+                          SignatureStats &stats) {
+  if (patterns.empty()) return;
+
+  PhaseTimer timer(stats.scanNs);
+  ScanLimits limits;
+  limits.alignment = alignment;
+  const ScanState state = scanPatterns(regions, patterns, limits);
+  for (size_t i = 0; i < patterns.size(); ++i) {
+    addresses[patterns[i].slot] = state.found[i];
+  }
+  stats.scannedPatterns += patterns.size();
+  addScanStats(stats, state);
+}
+
+// Bit-parallel Shift-Add for one pattern. Every pattern byte owns a field of
+// fieldBits bits counting the mismatches of the alignment that ends with it;
+// fields never straddle words. The top bit of a field catches the count
+// passing its range and is moved into a sticky overflow copy after each step,
+// so one field never carries into the next.
+class ShiftAddMatcher {
+public:
+  ShiftAddMatcher(const ParsedPattern &pattern, size_t maxMismatches)
+      : mMaxMismatches(maxMismatches),
+        mFieldBits(static_cast<size_t>(std::bit_width(maxMismatches)) + 1),
+        mFieldsPerWord(64 / mFieldBits),
+        mWords((pattern.bytes.size() + mFieldsPerWord - 1) / mFieldsPerWord),
+        mLastWord((pattern.bytes.size() - 1) / mFieldsPerWord),
+        mLastShift((pattern.bytes.size() - 1) % mFieldsPerWord * mFieldBits),
+        mTable(256 * mWords), mCounts(mWords), mOverflow(mWords) {
+    const size_t usedBits = mFieldsPerWord * mFieldBits;
+    mWordMask = usedBits == 64 ? ~uint64_t{0} : (uint64_t{1} << usedBits) - 1;
+    for (size_t field = 0; field < mFieldsPerWord; ++field) {
+      mHighBits |= uint64_t{1} << (field * mFieldBits + mFieldBits - 1);
+    }
+    for (size_t i = 0; i < pattern.bytes.size(); ++i) {
+      const uint64_t one = uint64_t{1}
+                           << (i % mFieldsPerWord * mFieldBits);
+      for (size_t value = 0; value < 256; ++value) {
+        if (!matches(pattern.bytes[i], static_cast<uint8_t>(value))) {
+          mTable[value * mWords + i / mFieldsPerWord] |= one;
+        }
+      }
+    }
+  }
+
+  void reset() {
+    std::ranges::fill(mCounts, uint64_t{0});
+    std::ranges::fill(mOverflow, uint64_t{0});
+  }
+
+  // Feeds the next byte and returns the mismatches of the alignment ending
+  // at it, or SIZE_MAX when they exceed the limit.
+  size_t step(uint8_t value) {
+    const uint64_t *mismatches = &mTable[value * mWords];
+    const size_t carryShift = (mFieldsPerWord - 1) * mFieldBits;
+    uint64_t countCarry = 0;
+    uint64_t overflowCarry = 0;
+    for (size_t word = 0; word < mWords; ++word) {
+      const uint64_t nextCountCarry = mCounts[word] >> carryShift;
+      const uint64_t nextOverflowCarry = mOverflow[word] >> carryShift;
+      const uint64_t counts =
+          (((mCounts[word] << mFieldBits) & mWordMask) | countCarry) +
+          mismatches[word];
+      mOverflow[word] = ((mOverflow[word] << mFieldBits) & mWordMask) |
+                        overflowCarry | (counts & mHighBits);
+      mCounts[word] = counts & ~mHighBits;
+      countCarry = nextCountCarry;
+      overflowCarry = nextOverflowCarry;
+    }
+
+    const uint64_t fieldMask = (uint64_t{1} << mFieldBits) - 1;
+    if ((mOverflow[mLastWord] >> mLastShift) & fieldMask) return SIZE_MAX;
+    const size_t count = (mCounts[mLastWord] >> mLastShift) & fieldMask;
+    return count <= mMaxMismatches ? count : SIZE_MAX;
+  }
+
+private:
+  size_t mMaxMismatches;
+  size_t mFieldBits;
+  size_t mFieldsPerWord;
+  size_t mWords;
+  size_t mLastWord;
+  size_t mLastShift;
+  uint64_t mWordMask = 0;
+  uint64_t mHighBits = 0;
+  std::vector<uint64_t> mTable;
+  std::vector<uint64_t> mCounts;
+  std::vector<uint64_t> mOverflow;
+};
+
+struct FuzzyMatch {
+  uintptr_t address = 0;
+  size_t distance = SIZE_MAX;
+};
+
+bool isCloserMatch(const FuzzyMatch &match, const FuzzyMatch &best) {
+  return match.distance < best.distance ||
+         (match.distance == best.distance && match.address < best.address);
+}
+
+// Closest match of every pattern within maxMismatches differing bytes, the
+// lowest one among equals. Chunks are scanned in parallel like exact scans; a
+// pattern already matched exactly below a chunk skips that chunk.
+std::vector<FuzzyMatch>
+scanFuzzyPatterns(const std::vector<MemoryRegion> &regions,
+                  const std::vector<CompiledPattern> &patterns,
+                  size_t maxMismatches, size_t alignment,
+                  uint64_t &bytesScanned) {
+  std::vector<FuzzyMatch> best(patterns.size());
+  if (patterns.empty()) return best;
+
+  size_t overlap = 0;
+  for (const auto &entry : patterns) {
+    overlap = std::max(overlap, entry.pattern->bytes.size() - 1);
+  }
+  const auto chunks = splitScanChunks(regions, overlap);
+  std::vector<std::atomic<uintptr_t>> exactAt(patterns.size());
+  for (auto &address : exactAt) address.store(UINTPTR_MAX);
+  std::atomic<size_t> nextChunk{0};
+  std::mutex mergeMutex;
+
+  auto worker = [&] {
+    std::vector<ShiftAddMatcher> matchers;
+    matchers.reserve(patterns.size());
+    for (const auto &entry : patterns) {
+      matchers.emplace_back(*entry.pattern,
+                            std::min(maxMismatches,
+                                     entry.pattern->bytes.size()));
+    }
+    std::vector<size_t> active;
+    std::vector<FuzzyMatch> local(patterns.size());
+    uint64_t scanned = 0;
+    for (size_t chunk = nextChunk.fetch_add(1); chunk < chunks.size();
+         chunk = nextChunk.fetch_add(1)) {
+      const auto &[region, ownedEnd] = chunks[chunk];
+      active.clear();
+      for (size_t i = 0; i < patterns.size(); ++i) {
+        if (exactAt[i].load(std::memory_order_relaxed) < region.start) {
+          continue;
+        }
+        matchers[i].reset();
+        local[i] = {};
+        active.push_back(i);
+      }
+      if (active.empty()) continue;
+
+      const auto *data = reinterpret_cast<const uint8_t *>(region.start);
+      const size_t regionSize = region.end - region.start;
+      for (size_t offset = 0; offset < regionSize; ++offset) {
+        for (const size_t i : active) {
+          const size_t distance = matchers[i].step(data[offset]);
+          const size_t size = patterns[i].pattern->bytes.size();
+          if (distance >= local[i].distance || offset + 1 < size) continue;
+          const uintptr_t start = region.start + offset + 1 - size;
+          if (start >= ownedEnd || (start & (alignment - 1)) != 0) continue;
+          local[i] = FuzzyMatch{start, distance};
+        }
+      }
+      scanned += regionSize;
+
+      std::lock_guard lock(mergeMutex);
+      for (const size_t i : active) {
+        if (isCloserMatch(local[i], best[i])) best[i] = local[i];
+        if (best[i].distance == 0) {
+          exactAt[i].store(best[i].address, std::memory_order_relaxed);
+        }
+      }
+    }
+    std::lock_guard lock(mergeMutex);
+    bytesScanned += scanned;
+  };
+
+  size_t totalBytes = 0;
+  for (const auto &region : regions) totalBytes += region.end - region.start;
+  const size_t workerCount =
+      totalBytes < kMinParallelScanBytes ? 1 : getScanWorkerCount();
+  std::vector<std::thread> threads;
+  threads.reserve(workerCount - 1);
+  for (size_t i = 1; i < workerCount; ++i) {
+    try {
+      threads.emplace_back(worker);
+    } catch (const std::system_error &) {
+      break;
+    }
+  }
+  worker();
+  for (auto &thread : threads) thread.join();
+  return best;
+}
+
+struct PersistentSignatureCache {
+  StringMap<uintptr_t> offsets;
+};
+
+std::mutex persistentCacheMutex;
+std::filesystem::path persistentCacheDirectory;
+std::unordered_map<std::string, PersistentSignatureCache> persistentCaches;
+
+StringMap<StringMap<uintptr_t>> offsetHints;
+
+void appendScopeTag(std::string &fileName, std::string_view scopeTag) {
+  if (scopeTag.empty()) return;
+  fileName.push_back('-');
+  for (const char ch : scopeTag) {
+    fileName.push_back(std::isalnum(static_cast<unsigned char>(ch)) ? ch : '_');
+  }
+}
+
+std::filesystem::path getPersistentCachePath(std::string_view moduleName,
+                                             const ModuleInfo &module,
+                                             std::string_view scopeTag) {
+  std::lock_guard lock(persistentCacheMutex);
+  if (persistentCacheDirectory.empty() || module.cacheKey.empty() ||
+      module.base == 0) {
+    return {};
+  }
+  std::string fileName = std::filesystem::path(moduleName).filename().string() +
+                         "-" + module.cacheKey;
+  appendScopeTag(fileName, scopeTag);
+  fileName += ".sigcache";
+  return persistentCacheDirectory / fileName;
+}
+
+// Unlike the per-build cache this file is shared by every build of the
+// module: it only says where to start looking, never where a match is.
+std::filesystem::path getOffsetHintPath(std::string_view moduleName,
+                                        const ModuleInfo &module,
+                                        std::string_view scopeTag) {
+  std::lock_guard lock(persistentCacheMutex);
+  if (persistentCacheDirectory.empty() || module.base == 0) return {};
+  std::string fileName = std::filesystem::path(moduleName).filename().string();
+  appendScopeTag(fileName, scopeTag);
+  fileName += ".sighint";
+  return persistentCacheDirectory / fileName;
+}
+
+void readPersistentCache(const std::filesystem::path &path,
+                         PersistentSignatureCache &cache) {
+  std::ifstream file(path);
+  std::string line;
+  if (!file || !std::getline(file, line) || line != kPersistentCacheHeader) {
+    return;
+  }
+
+  while (std::getline(file, line)) {
+    const size_t separator = line.find(' ');
+    if (separator == std::string::npos || separator + 1 >= line.size()) {
+      continue;
+    }
+    uintptr_t offset = 0;
+    if (std::sscanf(line.c_str(), "%" SCNxPTR, &offset) != 1) continue;
+    cache.offsets[line.substr(separator + 1)] = offset;
+  }
+}
+
+void writePersistentCache(const std::filesystem::path &path,
+                          const PersistentSignatureCache &cache) {
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+
+  auto tempPath = path;
+  tempPath += ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::trunc);
+    if (!file) return;
+    file << kPersistentCacheHeader << '\n';
+    char offset[32];
+    for (const auto &[signature, value] : cache.offsets) {
+      std::snprintf(offset, sizeof(offset), "%" PRIxPTR, value);
+      file << offset << ' ' << signature << '\n';
+    }
+    if (!file) return;
+  }
+  std::filesystem::rename(tempPath, path, error);
+  if (error) {
+    preloaderLogger.warn("failed to store signature cache {}: {}",
+                         path.string(), error.message());
+  }
+}
+
+PersistentSignatureCache &
+getPersistentCache(const std::filesystem::path &path) {
+  const auto [it, inserted] = persistentCaches.try_emplace(path.string());
+  if (inserted) readPersistentCache(path, it->second);
+  return it->second;
+}
+
+bool isReadableRange(const std::vector<MemoryRegion> &regions,
+                     uintptr_t address, size_t size) {
+  for (const auto &region : regions) {
+    if (address >= region.start && address <= region.end &&
+        size <= region.end - address) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool matchesCachedAddress(const std::vector<MemoryRegion> &regions,
+                          uintptr_t address, const ParsedPattern &pattern) {
+  if (!isReadableRange(regions, address, pattern.bytes.size())) return false;
+  const auto *data = reinterpret_cast<const uint8_t *>(address);
+  for (const size_t index : pattern.checkIndices) {
+    if (!matches(pattern.bytes[index], data[index])) return false;
+  }
+  return true;
+}
+
+// Walks the pattern's address ops from a verified match. Every read stays
+// inside the module's readable mappings; any step that fails yields 0.
+uintptr_t deriveAddress(const std::vector<MemoryRegion> &regions,
+                        uintptr_t address,
+                        const std::vector<SignatureOp> &derive) {
+  const CodeReader read = [&regions](uintptr_t at, void *out, size_t size) {
+    if (!isReadableRange(regions, at, size)) return false;
+    std::memcpy(out, reinterpret_cast<const void *>(at), size);
+    return true;
+  };
+
+  for (const auto &op : derive) {
+    if (address == 0) return 0;
+    bool ok = true;
+    switch (op.kind) {
+    case SignatureOpKind::Offset:
+      address += static_cast<uintptr_t>(op.offset);
+      break;
+    case SignatureOpKind::Branch:
+      ok = decodeBranchTarget(kNativeInstructionSet, address, read, address);
+      break;
+    case SignatureOpKind::PcRelative:
+      ok = decodePcRelativeTarget(kNativeInstructionSet, address, read,
+                                  address);
+      break;
+    case SignatureOpKind::Dereference:
+      ok = read(address, &address, sizeof(address));
+      break;
+    }
+    if (!ok) return 0;
+  }
+  return address;
+}
+
+using DerivedPatterns =
+    std::vector<std::pair<size_t, std::vector<SignatureOp>>>;
+
+DerivedPatterns
+collectDerivedPatterns(const std::vector<CompiledPattern> &compiled) {
+  DerivedPatterns derived;
+  for (const auto &entry : compiled) {
+    if (!entry.pattern->derive.empty()) {
+      derived.emplace_back(entry.slot, entry.pattern->derive);
+    }
+  }
+  return derived;
+}
+
+// Match addresses are what the persistent cache remembers and validates, so
+// derivation runs last and only its result reaches the caller.
+void applyDerivedAddresses(const std::vector<MemoryRegion> &regions,
+                           const DerivedPatterns &derived,
+                           std::span<uintptr_t> addresses) {
+  for (const auto &[slot, derive] : derived) {
+    addresses[slot] = deriveAddress(regions, addresses[slot], derive);
+  }
+}
+
+// Drops every pattern whose remembered offset still matches byte-for-byte, so
+// only the remaining ones have to be scanned.
+void applyPersistentCache(const std::filesystem::path &path,
+                          const ModuleInfo &module,
+                          const std::vector<MemoryRegion> &regions,
+                          std::vector<CompiledPattern> &compiled,
+                          std::span<uintptr_t> addresses) {
+  if (path.empty()) return;
+
+  std::lock_guard lock(persistentCacheMutex);
+  auto &cache = getPersistentCache(path);
+  std::erase_if(compiled, [&](const CompiledPattern &entry) {
+    const auto it = cache.offsets.find(entry.signature);
+    if (it == cache.offsets.end()) return false;
+    const uintptr_t address = module.base + it->second;
+    if (!matchesCachedAddress(regions, address, *entry.pattern)) return false;
+    addresses[entry.slot] = address;
+    return true;
+  });
+}
+
+// Offsets the window search starts from, kNoOffsetHint where there is none.
+std::vector<uintptr_t>
+collectOffsetHints(std::string_view moduleName,
+                   const std::filesystem::path &hintPath,
+                   const std::vector<CompiledPattern> &compiled) {
+  std::vector<uintptr_t> hints(compiled.size(), kNoOffsetHint);
+  std::lock_guard lock(persistentCacheMutex);
+  const auto explicitHints = offsetHints.find(moduleName);
+  const auto *stored =
+      hintPath.empty() ? nullptr : &getPersistentCache(hintPath).offsets;
+  for (size_t i = 0; i < compiled.size(); ++i) {
+    const auto &signature = compiled[i].signature;
+    if (explicitHints != offsetHints.end()) {
+      const auto it = explicitHints->second.find(signature);
+      if (it != explicitHints->second.end()) {
+        hints[i] = it->second;
+        continue;
+      }
+    }
+    if (stored) {
+      const auto it = stored->find(signature);
+      if (it != stored->end()) hints[i] = it->second;
+    }
+  }
+  return hints;
+}
+
+size_t countRegionBytes(const std::vector<MemoryRegion> &regions) {
+  size_t bytes = 0;
+  for (const auto &region : regions) bytes += region.end - region.start;
+  return bytes;
+}
+
+// Tries each pattern at its hint, then in windows that grow from
+// kMinHintWindow to kMaxHintWindow bytes on each side of it, and returns the
+// patterns none of them matched, which still need the full scan. A window hit
+// is the lowest match in the first window that has one, so it is the one
+// nearest the old location rather than necessarily the lowest in the module;
+// its slot is set in nearHint so it is returned but not remembered. Proving
+// there is no earlier match would cost the scan the hint is there to avoid.
+// Windows stop once they have covered half the scan regions in total,
+// bounding what stale hints cost.
+std::vector<CompiledPattern>
+searchOffsetHints(std::string_view moduleName,
+                  const std::filesystem::path &hintPath,
+                  const ModuleInfo &module,
+                  const std::vector<MemoryRegion> &regions, size_t alignment,
+                  const std::vector<CompiledPattern> &compiled,
+                  std::span<uintptr_t> addresses, std::vector<bool> &nearHint,
+                  SignatureStats &stats) {
+  const auto hints = collectOffsetHints(moduleName, hintPath, compiled);
+  size_t budget = countRegionBytes(regions) / 2;
+  ScanLimits limits;
+  limits.alignment = alignment;
+
+  std::vector<CompiledPattern> remaining;
+  for (size_t i = 0; i < compiled.size(); ++i) {
+    const auto &entry = compiled[i];
+    uintptr_t found = 0;
+    if (hints[i] != kNoOffsetHint && !entry.pattern->checkIndices.empty() &&
+        hints[i] < UINTPTR_MAX - module.base) {
+      const uintptr_t hint = module.base + hints[i];
+      if ((hint & (alignment - 1)) == 0 &&
+          matchesCachedAddress(regions, hint, *entry.pattern)) {
+        found = hint;
+      }
+      const std::vector<CompiledPattern> single{entry};
+      size_t previousBytes = 0;
+      for (size_t radius = kMinHintWindow;
+           found == 0 && radius <= kMaxHintWindow;
+           radius *= kHintWindowGrowth) {
+        const uintptr_t start = hint > radius ? hint - radius : 0;
+        const uintptr_t end =
+            hint + std::min(radius + entry.pattern->bytes.size(),
+                            UINTPTR_MAX - hint);
+        const auto window = clipRegions(regions, start, end);
+        const size_t bytes = countRegionBytes(window);
+        if (bytes == previousBytes || bytes > budget) break;
+        budget -= bytes;
+        previousBytes = bytes;
+        const auto state = scanPatterns(window, single, limits);
+        addScanStats(stats, state);
+        found = state.found[0];
+        // A window reaching the start of the regions holds nothing earlier.
+        nearHint[entry.slot] =
+            found != 0 && window.front().start != regions.front().start;
+      }
+      ++(found != 0 ? stats.hintHits : stats.hintMisses);
+    }
+    if (found != 0) {
+      addresses[entry.slot] = found;
+    } else {
+      remaining.push_back(entry);
+    }
+  }
+  return remaining;
+}
+
+// Slots set in skipped keep whatever offset the cache had for them.
+bool storeOffsets(PersistentSignatureCache &cache, const ModuleInfo &module,
+                  const std::vector<CompiledPattern> &compiled,
+                  std::span<const uintptr_t> addresses,
+                  const std::vector<bool> &skipped) {
+  bool changed = false;
+  for (const auto &entry : compiled) {
+    const uintptr_t address = addresses[entry.slot];
+    if (address < module.base || skipped[entry.slot] ||
+        entry.pattern->checkIndices.empty() ||
+        entry.signature.find_first_of("\r\n") != std::string_view::npos) {
+      continue;
+    }
+    const uintptr_t offset = address - module.base;
+    const auto cached = cache.offsets.find(entry.signature);
+    if (cached == cache.offsets.end()) {
+      cache.offsets.emplace(std::string(entry.signature), offset);
+    } else if (cached->second != offset) {
+      cached->second = offset;
+    } else {
+      continue;
+    }
+    changed = true;
+  }
+  return changed;
+}
+
+// The build's cache only takes lowest matches; the hints also take matches
+// found near a hint, which are still the best place to start next time.
+void storePersistentCache(const std::filesystem::path &path,
+                          const std::filesystem::path &hintPath,
+                          const ModuleInfo &module,
+                          const std::vector<CompiledPattern> &compiled,
+                          std::span<const uintptr_t> addresses,
+                          const std::vector<bool> &nearHint) {
+  if (compiled.empty()) return;
+
+  std::lock_guard lock(persistentCacheMutex);
+  const std::vector<bool> none(nearHint.size(), false);
+  for (const auto *target : {&path, &hintPath}) {
+    if (target->empty()) continue;
+    auto &cache = getPersistentCache(*target);
+    if (storeOffsets(cache, module, compiled, addresses,
+                     target == &path ? nearHint : none)) {
+      writePersistentCache(*target, cache);
+    }
+  }
+}
+
+// Start addresses, ascending, at which the pattern's rarest exact grams all
+// occur in the index. A match can start at any offset from the sampled gram
+// positions, so each of the kGramStep pattern offsets needs an exact gram of
+// its own; false means some offset has none and the index rules nothing out.
+bool findGramCandidates(const GramIndex &index, const ParsedPattern &pattern,
+                        std::vector<uintptr_t> &starts) {
+  struct Gram {
+    size_t offset = 0;
+    std::span<const uint32_t> postings;
+  };
+  const auto &bytes = pattern.bytes;
+  std::vector<Gram> grams;
+  std::vector<uint32_t> phaseStarts;
+  for (size_t phase = 0; phase < GramIndex::kGramStep; ++phase) {
+    grams.clear();
+    for (size_t offset = phase; offset + GramIndex::kGramSize <= bytes.size();
+         offset += GramIndex::kGramStep) {
+      std::array<uint8_t, GramIndex::kGramSize> gram{};
+      bool exact = true;
+      for (size_t i = 0; i < gram.size() && exact; ++i) {
+        exact = isExactByte(bytes[offset + i]);
+        gram[i] = bytes[offset + i].value;
+      }
+      if (exact) grams.push_back(Gram{offset, index.find(gram)});
+    }
+    if (grams.empty()) return false;
+    std::ranges::sort(grams, {},
+                      [](const Gram &gram) { return gram.postings.size(); });
+    grams.resize(std::min(grams.size(), kMaxIntersectedGrams));
+
+    // Postings are sorted and shifting them by a gram's offset keeps them
+    // so, which lets each further gram narrow the starts in one pass.
+    phaseStarts.clear();
+    for (const uint32_t position : grams[0].postings) {
+      if (position >= grams[0].offset) {
+        phaseStarts.push_back(position - grams[0].offset);
+      }
+    }
+    for (size_t i = 1; i < grams.size() && !phaseStarts.empty(); ++i) {
+      const auto postings = grams[i].postings;
+      auto next = postings.begin();
+      size_t kept = 0;
+      for (const uint32_t start : phaseStarts) {
+        const uint64_t position = uint64_t{start} + grams[i].offset;
+        next = std::lower_bound(next, postings.end(), position,
+                                [](uint32_t left, uint64_t right) {
+                                  return left < right;
+                                });
+        if (next == postings.end()) break;
+        if (*next == position) phaseStarts[kept++] = start;
+      }
+      phaseStarts.resize(kept);
+    }
+    for (const uint32_t start : phaseStarts) {
+      starts.push_back(index.base() + start);
+    }
+  }
+  std::ranges::sort(starts);
+  return true;
+}
+
+// Parts of regions the index does not cover, each widened by overlap bytes on
+// both sides so a match that crosses into an indexed range is still scanned.
+std::vector<MemoryRegion>
+getUnindexedRegions(const std::vector<MemoryRegion> &regions,
+                    std::span<const IndexedRange> ranges, size_t overlap) {
+  std::vector<MemoryRegion> unindexed;
+  const auto add = [&](const MemoryRegion &region, uintptr_t start,
+                       uintptr_t end) {
+    start -= std::min<uintptr_t>(start - region.start, overlap);
+    end += std::min<uintptr_t>(region.end - end, overlap);
+    if (!unindexed.empty() && unindexed.back().end >= start) {
+      unindexed.back().end = std::max(unindexed.back().end, end);
+      return;
+    }
+    unindexed.push_back(MemoryRegion{start, end});
+  };
+  for (const auto &region : regions) {
+    uintptr_t cursor = region.start;
+    for (const auto &range : ranges) {
+      if (range.end <= cursor || range.start >= region.end) continue;
+      if (range.start > cursor) add(region, cursor, range.start);
+      cursor = std::min(range.end, region.end);
+    }
+    if (cursor < region.end) add(region, cursor, region.end);
+  }
+  return unindexed;
+}
+
+// Verifies the index's candidates of each pattern in address order, so the
+// first that matches is the lowest match in the indexed ranges; what the
+// index does not cover is scanned and the lower of both results wins. Returns
+// the patterns the index cannot look up, which still need the full scan.
+std::vector<CompiledPattern>
+searchGramIndex(const GramIndex &index,
+                const std::vector<MemoryRegion> &regions, size_t alignment,
+                const std::vector<CompiledPattern> &compiled,
+                std::span<uintptr_t> addresses, SignatureStats &stats) {
+  std::vector<CompiledPattern> remaining;
+  std::vector<CompiledPattern> indexed;
+  std::vector<uintptr_t> found;
+  std::vector<uintptr_t> starts;
+  size_t longest = 0;
+  for (const auto &entry : compiled) {
+    starts.clear();
+    if (entry.pattern->checkIndices.empty() ||
+        !findGramCandidates(index, *entry.pattern, starts)) {
+      remaining.push_back(entry);
+      continue;
+    }
+    uintptr_t address = 0;
+    for (const uintptr_t start : starts) {
+      ++stats.candidates;
+      if ((start & (alignment - 1)) == 0 &&
+          matchesCachedAddress(regions, start, *entry.pattern)) {
+        address = start;
+        break;
+      }
+      ++stats.verificationFailures;
+    }
+    indexed.push_back(entry);
+    found.push_back(address);
+    longest = std::max(longest, entry.pattern->bytes.size());
+  }
+  stats.indexedPatterns += indexed.size();
+  if (indexed.empty()) return remaining;
+
+  const auto unindexed =
+      getUnindexedRegions(regions, index.ranges(), longest - 1);
+  if (!unindexed.empty()) {
+    ScanLimits limits;
+    limits.alignment = alignment;
+    const auto state = scanPatterns(unindexed, indexed, limits);
+    addScanStats(stats, state);
+    for (size_t i = 0; i < indexed.size(); ++i) {
+      if (state.found[i] != 0 && (found[i] == 0 || state.found[i] < found[i])) {
+        found[i] = state.found[i];
+      }
+    }
+  }
+  for (size_t i = 0; i < indexed.size(); ++i) {
+    addresses[indexed[i].slot] = found[i];
+  }
+  return remaining;
+}
+
+// Every match source in order of cost: the build's cache, the offset hints,
+// the module's gram index when one is ready and finally a scan of everything
+// left. Results are match addresses; the caller applies address ops. Returns
+// the slots found near a hint, which callers must not remember as resolved.
+std::vector<bool>
+findPatternMatches(std::string_view moduleName, const ModuleInfo &module,
+                   const std::vector<MemoryRegion> &regions,
+                   std::string_view scopeTag, size_t alignment,
+                   const GramIndex *gramIndex,
+                   std::vector<CompiledPattern> &compiled,
+                   std::span<uintptr_t> addresses, SignatureStats &stats) {
+  const auto cachePath = getPersistentCachePath(moduleName, module, scopeTag);
+  const auto hintPath = getOffsetHintPath(moduleName, module, scopeTag);
+  if (!cachePath.empty()) {
+    PhaseTimer timer(stats.cacheNs);
+    const size_t pending = compiled.size();
+    applyPersistentCache(cachePath, module, regions, compiled, addresses);
+    stats.persistentCacheHits += pending - compiled.size();
+    stats.persistentCacheMisses += compiled.size();
+  }
+
+  std::vector<CompiledPattern> remaining;
+  std::vector<bool> nearHint(addresses.size(), false);
+  {
+    PhaseTimer timer(stats.hintNs);
+    remaining =
+        searchOffsetHints(moduleName, hintPath, module, regions, alignment,
+                          compiled, addresses, nearHint, stats);
+  }
+  if (gramIndex) {
+    PhaseTimer timer(stats.indexNs);
+    remaining = searchGramIndex(*gramIndex, regions, alignment, remaining,
+                                addresses, stats);
+  }
+  scanCompiledPatterns(regions, remaining, alignment, addresses, stats);
+
+  PhaseTimer timer(stats.cacheNs);
+  storePersistentCache(cachePath, hintPath, module, compiled, addresses,
+                       nearHint);
+  return nearHint;
+}
+
+// The module's file mapped on its own. Hooks may already have patched the
+// loaded image, so indexes that later launches reuse are built from this
+// instead. nullptr when the file on disk is not the build that was loaded.
+std::shared_ptr<const MappedModuleFile>
+mapModuleFile(const ModuleInfo &module) {
+  auto file = std::make_shared<const MappedModuleFile>(module.path);
+  if (!file->valid()) return nullptr;
+  const auto &image = file->image();
+  const std::string cacheKey = !image.buildId.empty()
+                                   ? image.buildId
+                                   : makeFileFingerprint(image.path);
+  return cacheKey == module.cacheKey ? file : nullptr;
+}
+
+// Suffix index of the executable segments of a module's file at one
+// alignment, rebuilt when the module is. Positions are in the file mapping,
+// which the index reads on every lookup: a sort over live code would change
+// under a hook installed meanwhile, and a stored order would be trusted by
+// later launches whatever the code was patched to.
+struct ModuleSuffixIndex {
+  std::shared_ptr<const ModuleInfo> module;
+  std::shared_ptr<const MappedModuleFile> file;
+  std::shared_ptr<const SuffixIndex> index;
+};
+
+std::mutex suffixIndexMutex;
+std::map<std::pair<std::string, size_t>, ModuleSuffixIndex> suffixIndexes;
+
+std::filesystem::path getSuffixIndexPath(std::string_view moduleName,
+                                         const ModuleInfo &module,
+                                         size_t alignment) {
+  std::lock_guard lock(persistentCacheMutex);
+  if (persistentCacheDirectory.empty() || module.cacheKey.empty()) return {};
+  return persistentCacheDirectory /
+         (std::filesystem::path(moduleName).filename().string() + "-" +
+          module.cacheKey + "-a" + std::to_string(alignment) + ".sigindex");
+}
+
+// Loads the module's index from the cache directory, or builds and stores it
+// there. Callers wait for one build instead of each starting their own. The
+// index is null when the module file cannot be indexed.
+ModuleSuffixIndex
+getSuffixIndex(std::string_view moduleName,
+               const std::shared_ptr<const ModuleInfo> &module,
+               size_t alignment) {
+  std::lock_guard lock(suffixIndexMutex);
+  auto &entry = suffixIndexes[{std::string(moduleName), alignment}];
+  if (entry.module == module && entry.index) return entry;
+
+  auto file = mapModuleFile(*module);
+  if (!file) {
+    preloaderLogger.warn("cannot index {}: its file is not the loaded build",
+                         moduleName);
+    return {};
+  }
+  const auto &image = file->image();
+  std::vector<IndexedRange> ranges;
+  for (const auto &segment : image.segments) {
+    if (segment.executable) {
+      ranges.push_back(IndexedRange{segment.start, segment.end});
+    }
+  }
+  auto index =
+      std::make_shared<SuffixIndex>(image.base, std::move(ranges), alignment);
+  const auto path = getSuffixIndexPath(moduleName, *module, alignment);
+  if (path.empty() || !index->load(path)) {
+    const auto start = std::chrono::steady_clock::now();
+    if (!index->build(getScanWorkerCount())) {
+      preloaderLogger.warn("cannot index the code of {}", moduleName);
+      return {};
+    }
+    preloaderLogger.debug("indexed {} code positions of {} in {} ms",
+                          index->size(), moduleName,
+                          elapsedNs(start) / 1000000);
+    if (!path.empty() && !index->save(path)) {
+      preloaderLogger.warn("failed to store signature index {}",
+                           path.string());
+    }
+  }
+  entry = ModuleSuffixIndex{module, std::move(file), std::move(index)};
+  return entry;
+}
+
+// Matches of bytes at the index's positions, counted up to limit. Only the
+// occurrences of the longest exact run that starts at an aligned pattern
+// offset are verified, which the index lists without a scan.
+size_t countIndexedMatches(const SuffixIndex &index,
+                           std::span<const SignatureByte> bytes,
+                           size_t limit) {
+  const size_t alignment = index.alignment();
+  size_t anchor = 0;
+  size_t anchorSize = 0;
+  for (size_t i = 0; i < bytes.size(); i += alignment) {
+    size_t size = 0;
+    while (i + size < bytes.size() && size < SuffixIndex::kDepth &&
+           isExactByte(bytes[i + size])) {
+      ++size;
+    }
+    if (size > anchorSize) {
+      anchor = i;
+      anchorSize = size;
+    }
+  }
+  std::vector<uint8_t> key(anchorSize);
+  for (size_t i = 0; i < anchorSize; ++i) key[i] = bytes[anchor + i].value;
+
+  size_t count = 0;
+  for (const uint32_t offset : index.find(key)) {
+    if (offset < anchor) continue;
+    const uintptr_t start = index.base() + offset - anchor;
+    const auto *range = index.findRange(index.base() + offset);
+    if (start < range->start || bytes.size() > range->end - start) continue;
+    const auto *data = reinterpret_cast<const uint8_t *>(start);
+    bool matched = true;
+    for (size_t i = 0; i < bytes.size() && matched; ++i) {
+      matched = matches(bytes[i], data[i]);
+    }
+    if (matched && ++count >= limit) break;
+  }
+  return count;
+}
+
+std::string formatSignature(std::span<const SignatureByte> bytes) {
+  constexpr std::string_view kDigits = "0123456789ABCDEF";
+  std::string text;
+  text.reserve(bytes.size() * 3);
+  for (const auto &byte : bytes) {
+    if (!text.empty()) text += ' ';
+    text += (byte.mask & 0xF0) ? kDigits[byte.value >> 4] : '?';
+    text += (byte.mask & 0x0F) ? kDigits[byte.value & 0xF] : '?';
+  }
+  return text;
+}
+
+// Gram index of a module's read-only mappings, kept for the loaded instance
+// it was built from. Entries exist only for modules the index was enabled
+// for.
+struct ModuleGramIndex {
+  std::mutex mutex;
+  std::shared_ptr<const ModuleInfo> module;
+  std::shared_ptr<const GramIndex> index;
+};
+
+std::mutex gramIndexMutex;
+StringMap<std::shared_ptr<ModuleGramIndex>> gramIndexes;
+
+// Owns the threads of background resolves and index builds. Finished ones are
+// joined whenever another starts and the rest at exit, from a handler the first
+// start registers: it runs before any static constructed earlier is destroyed,
+// which covers the caches here and the module map and logger the tasks use.
+class BackgroundThreads {
+public:
+  BackgroundThreads() = default;
+  BackgroundThreads(const BackgroundThreads &) = delete;
+  BackgroundThreads &operator=(const BackgroundThreads &) = delete;
+
+  ~BackgroundThreads() { joinAll(); }
+
+  // Tasks running meanwhile may start more, so this joins until none is left.
+  void joinAll() {
+    for (;;) {
+      std::vector<Worker> workers;
+      {
+        std::lock_guard lock(mMutex);
+        workers.swap(mWorkers);
+      }
+      if (workers.empty()) return;
+      for (auto &worker : workers) worker.thread.join();
+    }
+  }
+
+  // Throws std::system_error when the thread cannot be started.
+  void start(std::function<void()> task) {
+    std::call_once(mExitHook, [] { std::atexit(joinAtExit); });
+    auto done = std::make_shared<std::atomic_bool>(false);
+    std::lock_guard lock(mMutex);
+    std::erase_if(mWorkers, [](Worker &worker) {
+      if (!worker.done->load(std::memory_order_acquire)) return false;
+      worker.thread.join();
+      return true;
+    });
+    mWorkers.reserve(mWorkers.size() + 1);
+    std::thread thread([task = std::move(task), done] {
+      task();
+      done->store(true, std::memory_order_release);
+    });
+    mWorkers.push_back(Worker{std::move(thread), std::move(done)});
+  }
+
+private:
+  struct Worker {
+    std::thread thread;
+    std::shared_ptr<std::atomic_bool> done;
+  };
+
+  static void joinAtExit();
+
+  std::once_flag mExitHook;
+  std::mutex mMutex;
+  std::vector<Worker> mWorkers;
+};
+
+BackgroundThreads backgroundThreads;
+
+void BackgroundThreads::joinAtExit() { backgroundThreads.joinAll(); }
+
+std::filesystem::path getGramIndexPath(std::string_view moduleName,
+                                       const ModuleInfo &module) {
+  std::lock_guard lock(persistentCacheMutex);
+  if (persistentCacheDirectory.empty() || module.cacheKey.empty()) return {};
+  return persistentCacheDirectory /
+         (std::filesystem::path(moduleName).filename().string() + "-" +
+          module.cacheKey + ".siggram");
+}
+
+// Maps the index an earlier launch stored for this build, or builds and
+// stores it, then hands it to the entry unless the module changed meanwhile.
+// Grams come from the module file: a gram read from patched memory would hide
+// the offsets where the shipped bytes match.
+void buildGramIndex(const std::string &moduleName,
+                    const std::shared_ptr<ModuleGramIndex> &entry,
+                    const std::shared_ptr<const ModuleInfo> &module) {
+  const auto file = mapModuleFile(*module);
+  if (!file) {
+    preloaderLogger.warn("cannot index {}: its file is not the loaded build",
+                         moduleName);
+    return;
+  }
+  // The file's read-only segments, moved to where the module has them. They
+  // end at the file contents, so page tails are left to the scan.
+  const auto &image = file->image();
+  std::vector<IndexedRange> ranges;
+  for (const auto &segment : image.segments) {
+    if (!segment.readable || segment.writable) continue;
+    const uintptr_t start = module->base + (segment.start - image.base);
+    const uintptr_t end = module->base + (segment.end - image.base);
+    if (!ranges.empty() && ranges.back().end == start) {
+      ranges.back().end = end;
+    } else {
+      ranges.push_back(IndexedRange{start, end});
+    }
+  }
+  const auto path = getGramIndexPath(moduleName, *module);
+  std::unique_ptr<GramIndex> index;
+  if (!path.empty()) index = GramIndex::open(module->base, ranges, path);
+  if (!index) {
+    const auto start = std::chrono::steady_clock::now();
+    index =
+        GramIndex::build(module->base, std::move(ranges), image.base, path);
+    if (!index) {
+      preloaderLogger.warn("cannot index the read-only mappings of {}",
+                           moduleName);
+      return;
+    }
+    preloaderLogger.debug("indexed {} grams of {} in {} ms", index->size(),
+                          moduleName, elapsedNs(start) / 1000000);
+    if (!path.empty() && !index->mapped()) {
+      preloaderLogger.warn("failed to store signature index {}",
+                           path.string());
+    }
+  }
+
+  std::lock_guard lock(entry->mutex);
+  if (entry->module == module) entry->index = std::move(index);
+}
+
+// The module's gram index once it is ready, or nullptr. The first call for a
+// loaded instance of the module starts the build on a background thread;
+// resolves made before it finishes scan as usual.
+std::shared_ptr<const GramIndex>
+getGramIndex(std::string_view moduleName,
+             const std::shared_ptr<const ModuleInfo> &module) {
+  std::shared_ptr<ModuleGramIndex> entry;
+  {
+    std::lock_guard lock(gramIndexMutex);
+    const auto it = gramIndexes.find(moduleName);
+    if (it == gramIndexes.end()) return nullptr;
+    entry = it->second;
+  }
+  {
+    std::lock_guard lock(entry->mutex);
+    if (entry->module == module) return entry->index;
+    entry->module = module;
+    entry->index.reset();
+  }
+
+  auto task = [moduleName = std::string(moduleName), entry, module] {
+    buildGramIndex(moduleName, entry, module);
+  };
+  try {
+    backgroundThreads.start(std::move(task));
+  } catch (const std::system_error &error) {
+    preloaderLogger.warn("signature index thread failed to start: {}",
+                         error.what());
+    std::lock_guard lock(entry->mutex);
+    entry->module.reset();
+  }
+  return nullptr;
+}
+
+struct SignatureRequest {
+  std::string signature;
+  std::string moduleName;
+  SignatureScanOptions options;
+  std::function<void(uintptr_t)> callback;
+};
+
+std::mutex signatureRequestMutex;
+std::vector<SignatureRequest> signatureRequests;
+bool signatureRequestsResolved = false;
+
+// Resolves signatures[i] into addresses[i], syncing the caches to the module
+// map first. Precompiled literals, when given, seed the pattern cache before
+// anything has to be parsed.
+void resolveSignatureSlots(std::span<const std::string_view> signatures,
+                           std::string_view moduleName,
+                           std::span<uintptr_t> addresses,
+                           const SignatureScanOptions &options,
+                           std::span<const PrecompiledSignature> precompiled) {
+  if (addresses.size() < signatures.size()) {
+    preloaderLogger.warn("{} addresses for {} signatures, resolving only the "
+                         "first ones",
+                         addresses.size(), signatures.size());
+    signatures = signatures.first(addresses.size());
+  }
+  addresses = addresses.first(signatures.size());
+  std::ranges::fill(addresses, uintptr_t{0});
+  ResolveStats recorder(moduleName);
+  if (moduleName.empty()) {
+    recorder.count(addresses);
+    return;
+  }
+
+  syncRecentModuleCaches();
+  const std::string scopeTag = makeScopeTag(options);
+  const auto table = getAddressTable(moduleName, scopeTag);
+  std::vector<PendingSignature> pending;
+  for (size_t i = 0; i < signatures.size(); ++i) {
+    if (table) {
+      const auto cached = table->find(signatures[i]);
+      if (cached != table->end()) {
+        addresses[i] = cached->second;
+        ++recorder.stats.addressCacheHits;
+        continue;
+      }
+    }
+    pending.push_back(PendingSignature{signatures[i], i});
+  }
+
+  if (pending.empty()) {
+    recorder.count(addresses);
+    return;
+  }
+
+  // Not remembered when missing: the module may simply not be loaded yet.
+  const auto moduleMap = syncModuleCaches();
+  const auto module = getCachedModuleInfo(*moduleMap, moduleName);
+  if (!module) {
+    recorder.count(addresses);
+    return;
+  }
+
+  std::vector<PendingSignature> symbols;
+  std::vector<PendingSignature> patterns;
+  classifySignatures(pending, symbols, patterns);
+  resolveSymbols(moduleMap->findModule(moduleName), module.get(), symbols,
+                 addresses, patterns, recorder.stats);
+
+  std::vector<bool> nearHint(addresses.size(), false);
+  if (!patterns.empty()) {
+    if (!precompiled.empty()) seedPatternCache(precompiled);
+    auto compiled = compilePatterns(patterns);
+    const auto derived = collectDerivedPatterns(compiled);
+    const auto regions =
+        getScanRegions(*module, std::string(moduleName), options);
+    const auto gramIndex = getGramIndex(moduleName, module);
+    nearHint = findPatternMatches(moduleName, *module, regions, scopeTag,
+                                  getScanAlignment(options), gramIndex.get(),
+                                  compiled, addresses, recorder.stats);
+    applyDerivedAddresses(module->regions, derived, addresses);
+  }
+
+  publishAddresses(moduleName, module, scopeTag, pending, addresses,
+                   nearHint);
+  recorder.count(addresses);
+}
+
+}
+
+std::unordered_map<std::string, uintptr_t>
+resolveSignatures(std::span<const std::string> signatures,
+                  std::string_view moduleName) {
+  return resolveSignatures(signatures, moduleName, SignatureScanOptions{});
+}
+
+std::unordered_map<std::string, uintptr_t>
+resolveSignatures(std::span<const std::string> signatures,
+                  std::string_view moduleName,
+                  const SignatureScanOptions &options) {
+  std::unordered_map<std::string, uintptr_t> results;
+  results.reserve(signatures.size());
+  std::vector<std::string_view> unique;
+  std::vector<uintptr_t *> slots;
+  unique.reserve(signatures.size());
+  slots.reserve(signatures.size());
+  for (const auto &signature : signatures) {
+    const auto [result, inserted] = results.try_emplace(signature, 0);
+    if (!inserted) continue;
+    unique.push_back(signature);
+    slots.push_back(&result->second);
+  }
+
+  std::vector<uintptr_t> addresses(unique.size(), 0);
+  resolveSignatureSlots(unique, moduleName, addresses, options, {});
+  for (size_t i = 0; i < slots.size(); ++i) *slots[i] = addresses[i];
+  return results;
+}
+
+void resolveSignatures(std::span<const std::string_view> signatures,
+                       std::string_view moduleName,
+                       std::span<uintptr_t> addresses,
+                       const SignatureScanOptions &options) {
+  resolveSignatureSlots(signatures, moduleName, addresses, options, {});
+}
+
+void resolveSignatures(std::span<const PrecompiledSignature> signatures,
+                       std::string_view moduleName,
+                       std::span<uintptr_t> addresses,
+                       const SignatureScanOptions &options) {
+  std::vector<std::string_view> texts;
+  texts.reserve(signatures.size());
+  for (const auto &signature : signatures) texts.push_back(signature.text);
+  resolveSignatureSlots(texts, moduleName, addresses, options, signatures);
+}
+
+void resolveSignatures(std::span<const ModuleSignature> signatures,
+                       std::span<uintptr_t> addresses,
+                       const SignatureScanOptions &options) {
+  if (addresses.size() < signatures.size()) {
+    preloaderLogger.warn("{} addresses for {} signatures, resolving only the "
+                         "first ones",
+                         addresses.size(), signatures.size());
+    signatures = signatures.first(addresses.size());
+  }
+
+  struct ModuleBatch {
+    std::string_view moduleName;
+    std::vector<std::string_view> signatures;
+    std::vector<size_t> slots;
+    std::vector<uintptr_t> addresses;
+  };
+  std::vector<ModuleBatch> batches;
+  std::unordered_map<std::string_view, size_t> batchIndices;
+  for (size_t i = 0; i < signatures.size(); ++i) {
+    const auto [it, inserted] =
+        batchIndices.try_emplace(signatures[i].moduleName, batches.size());
+    if (inserted) batches.emplace_back().moduleName = signatures[i].moduleName;
+    auto &batch = batches[it->second];
+    batch.signatures.push_back(signatures[i].signature);
+    batch.slots.push_back(i);
+  }
+
+  // One worker budget for both levels: a module big enough for a chunked
+  // scan takes the whole pool itself, so those run one after another, and
+  // only the small ones share the pool as one task per module.
+  const auto moduleMap = syncModuleCaches();
+  std::vector<ModuleBatch *> smallBatches;
+  for (auto &batch : batches) {
+    batch.addresses.resize(batch.signatures.size());
+    const auto module = getCachedModuleInfo(*moduleMap, batch.moduleName);
+    if (!module ||
+        countRegionBytes(getScanRegions(*module, std::string(batch.moduleName),
+                                        options)) < kMinParallelScanBytes) {
+      smallBatches.push_back(&batch);
+      continue;
+    }
+    resolveSignatureSlots(batch.signatures, batch.moduleName,
+                          batch.addresses, options, {});
+  }
+
+  std::atomic_size_t nextBatch{0};
+  const auto worker = [&] {
+    for (size_t i = nextBatch.fetch_add(1, std::memory_order_relaxed);
+         i < smallBatches.size();
+         i = nextBatch.fetch_add(1, std::memory_order_relaxed)) {
+      auto &batch = *smallBatches[i];
+      resolveSignatureSlots(batch.signatures, batch.moduleName,
+                            batch.addresses, options, {});
+    }
+  };
+
+  const size_t workerCount =
+      std::min(smallBatches.size(), getScanWorkerCount());
+  std::vector<std::thread> threads;
+  threads.reserve(workerCount > 0 ? workerCount - 1 : 0);
+  for (size_t i = 1; i < workerCount; ++i) {
+    try {
+      threads.emplace_back(worker);
+    } catch (const std::system_error &) {
+      break;
+    }
+  }
+  worker();
+  for (auto &thread : threads) thread.join();
+
+  for (const auto &batch : batches) {
+    for (size_t i = 0; i < batch.slots.size(); ++i) {
+      addresses[batch.slots[i]] = batch.addresses[i];
+    }
+  }
+}
+
+std::unordered_map<std::string, SignatureMatchInfo>
+resolveSignaturesDetailed(std::span<const std::string> signatures,
+                          std::string_view moduleName,
+                          const SignatureDetailOptions &options) {
+  ResolveStats recorder(moduleName);
+  std::unordered_map<std::string, SignatureMatchInfo> results;
+  for (const auto &signature : signatures) results[signature] = {};
+  const auto addressOf = [](const SignatureMatchInfo &info) {
+    return info.address;
+  };
+  recorder.count(results, addressOf);
+  if (moduleName.empty()) return results;
+
+  const auto moduleMap = syncModuleCaches();
+  const auto module = getCachedModuleInfo(*moduleMap, moduleName);
+  if (!module) return results;
+
+  std::vector<PendingSignature> pending;
+  std::vector<SignatureMatchInfo *> infos;
+  for (auto &[signature, info] : results) {
+    pending.push_back(PendingSignature{signature, infos.size()});
+    infos.push_back(&info);
+  }
+  std::vector<PendingSignature> symbols;
+  std::vector<PendingSignature> patterns;
+  classifySignatures(pending, symbols, patterns);
+  std::vector<uintptr_t> symbolAddresses(infos.size(), 0);
+  resolveSymbols(moduleMap->findModule(moduleName), module.get(), symbols,
+                 symbolAddresses, patterns, recorder.stats);
+  for (size_t i = 0; i < infos.size(); ++i) {
+    const uintptr_t symbol = symbolAddresses[i];
+    if (symbol != 0) *infos[i] = SignatureMatchInfo{symbol, 1, {symbol}, true};
+  }
+  if (patterns.empty()) {
+    recorder.count(results, addressOf);
+    return results;
+  }
+
+  const auto compiled = compilePatterns(patterns);
+  const auto regions =
+      getScanRegions(*module, std::string(moduleName), options.scan);
+  const ScanLimits limits{
+      std::max<size_t>({options.maxMatchCount, options.maxAddresses, 2}),
+      options.maxAddresses, getScanAlignment(options.scan)};
+  const auto scanStart = std::chrono::steady_clock::now();
+  auto state = scanPatterns(regions, compiled, limits);
+  recorder.stats.scanNs += elapsedNs(scanStart);
+  recorder.stats.scannedPatterns += compiled.size();
+  addScanStats(recorder.stats, state);
+
+  for (size_t i = 0; i < compiled.size(); ++i) {
+    const auto &derive = compiled[i].pattern->derive;
+    auto &info = *infos[compiled[i].slot];
+    info.address = deriveAddress(module->regions, state.found[i], derive);
+    info.matchCount = std::min(state.counts[i], options.maxMatchCount);
+    info.addresses = std::move(state.addresses[i]);
+    for (auto &address : info.addresses) {
+      address = deriveAddress(module->regions, address, derive);
+    }
+    info.unique = state.counts[i] == 1;
+  }
+  recorder.count(results, addressOf);
+  return results;
+}
+
+std::unordered_map<std::string, SignatureFuzzyMatch>
+resolveSignaturesFuzzy(std::span<const std::string> signatures,
+                       std::string_view moduleName,
+                       const SignatureFuzzyOptions &options) {
+  ResolveStats recorder(moduleName);
+  std::unordered_map<std::string, SignatureFuzzyMatch> results;
+  for (const auto &signature : signatures) results[signature] = {};
+  const auto addressOf = [](const SignatureFuzzyMatch &match) {
+    return match.address;
+  };
+  recorder.count(results, addressOf);
+  if (moduleName.empty()) return results;
+
+  const auto moduleMap = syncModuleCaches();
+  const auto module = getCachedModuleInfo(*moduleMap, moduleName);
+  if (!module) return results;
+
+  std::vector<PendingSignature> pending;
+  std::vector<SignatureFuzzyMatch *> outputs;
+  for (auto &[signature, match] : results) {
+    pending.push_back(PendingSignature{signature, outputs.size()});
+    outputs.push_back(&match);
+  }
+  std::vector<PendingSignature> symbols;
+  std::vector<PendingSignature> patterns;
+  classifySignatures(pending, symbols, patterns);
+  std::vector<uintptr_t> symbolAddresses(outputs.size(), 0);
+  resolveSymbols(moduleMap->findModule(moduleName), module.get(), symbols,
+                 symbolAddresses, patterns, recorder.stats);
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    outputs[i]->address = symbolAddresses[i];
+  }
+
+  const auto compiled = compilePatterns(patterns);
+  const auto regions =
+      getScanRegions(*module, std::string(moduleName), options.scan);
+  const auto scanStart = std::chrono::steady_clock::now();
+  const auto found = scanFuzzyPatterns(
+      regions, compiled, std::min(options.maxMismatches, kMaxFuzzyMismatches),
+      getScanAlignment(options.scan), recorder.stats.bytesScanned);
+  recorder.stats.scanNs += elapsedNs(scanStart);
+  recorder.stats.scannedPatterns += compiled.size();
+
+  for (size_t i = 0; i < compiled.size(); ++i) {
+    if (found[i].address == 0) continue;
+    const auto &pattern = *compiled[i].pattern;
+    auto &match = *outputs[compiled[i].slot];
+    const auto *data = reinterpret_cast<const uint8_t *>(found[i].address);
+    for (size_t index = 0; index < pattern.bytes.size(); ++index) {
+      if (!matches(pattern.bytes[index], data[index])) {
+        match.mismatches.push_back(index);
+      }
+    }
+    match.distance = found[i].distance;
+    match.address =
+        deriveAddress(module->regions, found[i].address, pattern.derive);
+  }
+  recorder.count(results, addressOf);
+  return results;
+}
+
+std::string generateSignature(uintptr_t address, std::string_view moduleName,
+                              const SignatureGenerateOptions &options) {
+  const auto moduleMap = syncModuleCaches();
+  const auto module = getCachedModuleInfo(*moduleMap, moduleName);
+  if (!module) return {};
+  const size_t alignment = normalizeAlignment(options.alignment);
+  const auto indexed = getSuffixIndex(moduleName, module, alignment);
+  if (!indexed.index) return {};
+  const auto &index = *indexed.index;
+  // The same offset in the file mapping, where the index has its bytes.
+  const uintptr_t fileAddress =
+      address >= module->base ? index.base() + (address - module->base) : 0;
+  const auto *range = index.findRange(fileAddress);
+  if (!range || (address & (alignment - 1)) != 0) {
+    preloaderLogger.warn("{:#x} is not an aligned code address of {}", address,
+                         moduleName);
+    return {};
+  }
+
+  // Pattern bytes instruction by instruction, with the bits that move with
+  // the code or its data masked at nibble granularity.
+  const CodeReader read = [range](uintptr_t at, void *out, size_t size) {
+    if (at < range->start || at > range->end || size > range->end - at) {
+      return false;
+    }
+    std::memcpy(out, reinterpret_cast<const void *>(at), size);
+    return true;
+  };
+  const size_t limit = std::min(options.maxLength, range->end - fileAddress);
+  const auto *data = reinterpret_cast<const uint8_t *>(fileAddress);
+  std::vector<SignatureByte> bytes;
+  std::vector<size_t> boundaries;
+  int pageRegister = -1;
+  while (bytes.size() < limit) {
+    size_t size = 1;
+    uint32_t mask = 0xFFFFFFFF;
+    if (options.wildcardRelocations &&
+        !decodeStableBits(kNativeInstructionSet, fileAddress + bytes.size(),
+                          read, size, mask, pageRegister)) {
+      size = 1;
+      mask = 0xFFFFFFFF;
+    }
+    for (size_t i = 0; i < size && bytes.size() < limit; ++i, mask >>= 8) {
+      const uint8_t byteMask = ((mask & 0xF0) == 0xF0 ? 0xF0 : 0) |
+                               ((mask & 0x0F) == 0x0F ? 0x0F : 0);
+      bytes.push_back(SignatureByte{
+          static_cast<uint8_t>(data[bytes.size()] & byteMask), byteMask});
+    }
+    boundaries.push_back(bytes.size());
+  }
+
+  // Longer prefixes match a subset of the places shorter ones do, so the
+  // shortest unique one is found by bisecting the instruction boundaries.
+  const auto isUnique = [&](size_t size) {
+    return countIndexedMatches(index, std::span(bytes).first(size), 2) == 1;
+  };
+  if (boundaries.empty() || !isUnique(boundaries.back())) {
+    preloaderLogger.warn("no unique signature of up to {} bytes at {:#x} in {}",
+                         limit, address, moduleName);
+    return {};
+  }
+  const auto shortest = std::partition_point(
+      boundaries.begin(), boundaries.end(),
+      [&](size_t size) { return !isUnique(size); });
+  size_t size = *shortest;
+  while (size > 1 && bytes[size - 1].mask == 0 && isUnique(size - 1)) --size;
+  return formatSignature(std::span(bytes).first(size));
+}
+
+size_t countSignatureMatches(std::string_view signature,
+                             std::string_view moduleName, size_t alignment) {
+  const auto moduleMap = syncModuleCaches();
+  const auto module = getCachedModuleInfo(*moduleMap, moduleName);
+  if (!module) return 0;
+  const auto pattern = getCachedPattern(signature);
+  if (pattern->bytes.empty()) return 0;
+  const auto indexed =
+      getSuffixIndex(moduleName, module, normalizeAlignment(alignment));
+  return indexed.index
+             ? countIndexedMatches(*indexed.index, pattern->bytes, SIZE_MAX)
+             : 0;
+}
+
+struct SignatureFuture::State {
+  std::mutex mutex;
+  std::condition_variable finished;
+  bool ready = false;
+  Results results;
+  std::vector<Callback> callbacks;
+
+  void complete(Results resolved) {
+    std::vector<Callback> pending;
+    {
+      std::lock_guard lock(mutex);
+      results = std::move(resolved);
+      ready = true;
+      pending.swap(callbacks);
+    }
+    finished.notify_all();
+    for (const auto &callback : pending) callback(results);
+  }
+};
+
+bool SignatureFuture::ready() const {
+  if (!mState) return false;
+  std::lock_guard lock(mState->mutex);
+  return mState->ready;
+}
+
+void SignatureFuture::wait() const {
+  if (!mState) return;
+  std::unique_lock lock(mState->mutex);
+  mState->finished.wait(lock, [this] { return mState->ready; });
+}
+
+const SignatureFuture::Results &SignatureFuture::get() const {
+  static const Results empty;
+  if (!mState) return empty;
+  wait();
+  return mState->results;
+}
+
+void SignatureFuture::onComplete(Callback callback) const {
+  if (!mState || !callback) return;
+  {
+    std::lock_guard lock(mState->mutex);
+    if (!mState->ready) {
+      mState->callbacks.push_back(std::move(callback));
+      return;
+    }
+  }
+  callback(mState->results);
+}
+
+SignatureFuture resolveSignaturesAsync(std::vector<std::string> signatures,
+                                       std::string moduleName,
+                                       SignatureScanOptions options) {
+  auto state = std::make_shared<SignatureFuture::State>();
+  auto task = [state, signatures = std::move(signatures),
+               moduleName = std::move(moduleName),
+               options = std::move(options)] {
+    state->complete(resolveSignatures(signatures, moduleName, options));
+  };
+
+  try {
+    backgroundThreads.start(task);
+  } catch (const std::system_error &error) {
+    preloaderLogger.warn("signature scan thread failed to start: {}",
+                         error.what());
+    task();
+  }
+  return SignatureFuture(std::move(state));
+}
+
+void requestSignature(std::string signature, std::string moduleName,
+                      std::function<void(uintptr_t)> callback,
+                      SignatureScanOptions options) {
+  if (!callback) return;
+  {
+    std::lock_guard lock(signatureRequestMutex);
+    if (!signatureRequestsResolved) {
+      signatureRequests.push_back(SignatureRequest{
+          std::move(signature), std::move(moduleName), std::move(options),
+          std::move(callback)});
+      return;
+    }
+  }
+  callback(resolveSignature(signature, moduleName, options));
+}
+
+void resolveRequestedSignatures() {
+  std::vector<SignatureRequest> requests;
+  {
+    std::lock_guard lock(signatureRequestMutex);
+    requests.swap(signatureRequests);
+    signatureRequestsResolved = true;
+  }
+  if (requests.empty()) return;
+
+  // Every module of one scan scope is resolved in a single batch.
+  std::map<std::string, std::vector<size_t>> batches;
+  for (size_t i = 0; i < requests.size(); ++i) {
+    batches[makeScopeTag(requests[i].options)].push_back(i);
+  }
+
+  std::vector<uintptr_t> addresses(requests.size(), 0);
+  for (const auto &[scopeTag, members] : batches) {
+    std::vector<ModuleSignature> signatures;
+    signatures.reserve(members.size());
+    for (const size_t index : members) {
+      const auto &request = requests[index];
+      signatures.push_back(
+          ModuleSignature{request.signature, request.moduleName});
+    }
+    std::vector<uintptr_t> found(members.size(), 0);
+    resolveSignatures(signatures, found, requests[members.front()].options);
+    for (size_t i = 0; i < members.size(); ++i) {
+      addresses[members[i]] = found[i];
+    }
+  }
+
+  preloaderLogger.debug("resolved {} deferred signatures in {} batches",
+                        requests.size(), batches.size());
+  for (size_t i = 0; i < requests.size(); ++i) {
+    requests[i].callback(addresses[i]);
+  }
+}
+
+std::vector<uintptr_t>
+scanSignatureBuffer(std::span<const std::string> signatures,
+                    std::span<const uint8_t> memory, size_t alignment) {
+  const auto compiled = compileBufferSignatures(signatures);
+  const auto start = reinterpret_cast<uintptr_t>(memory.data());
+  SignatureScanOptions options;
+  options.alignment = alignment;
+  SignatureStats stats;
+  std::vector<uintptr_t> addresses(signatures.size(), 0);
+  scanCompiledPatterns({MemoryRegion{start, start + memory.size()}}, compiled,
+                       getScanAlignment(options), addresses, stats);
+  return addresses;
+}
+
+std::optional<std::vector<uintptr_t>>
+scanSignatureBuffer(std::span<const std::string> signatures,
+                    std::span<const uint8_t> memory, ScanEngine engine,
+                    size_t alignment) {
+  const auto compiled = compileBufferSignatures(signatures);
+  const auto start = reinterpret_cast<uintptr_t>(memory.data());
+  const std::vector<MemoryRegion> regions{
+      MemoryRegion{start, start + memory.size()}};
+  SignatureScanOptions options;
+  options.alignment = alignment;
+  ScanLimits limits;
+  limits.alignment = getScanAlignment(options);
+  ScanState state = startScan(regions, compiled, limits);
+  ScanMatcher matcher;
+  if (!buildScanMatcher(compiled, state.active, limits.alignment, engine,
+                        matcher)) {
+    return std::nullopt;
+  }
+  runScan(regions, matcher, state);
+
+  std::vector<uintptr_t> addresses(signatures.size(), 0);
+  for (size_t i = 0; i < compiled.size(); ++i) {
+    addresses[compiled[i].slot] = state.found[i];
+  }
+  return addresses;
+}
+
+void clearSignatureCaches() {
+  {
+    std::unique_lock lock(cacheMutex);
+    patternCache.clear();
+    sectionCache.clear();
+    for (auto &slot : moduleSlots) {
+      slot.info.reset();
+      slot.scopes.clear();
+    }
+  }
+  {
+    std::lock_guard lock(suffixIndexMutex);
+    suffixIndexes.clear();
+  }
+  {
+    std::lock_guard lock(gramIndexMutex);
+    for (auto &[name, entry] : gramIndexes) {
+      std::lock_guard entryLock(entry->mutex);
+      entry->module.reset();
+      entry->index.reset();
+    }
+  }
+  std::lock_guard lock(persistentCacheMutex);
+  persistentCaches.clear();
+}
+
+void enableSignatureIndex(std::string_view moduleName) {
+  if (moduleName.empty()) return;
+  {
+    std::lock_guard lock(gramIndexMutex);
+    if (!gramIndexes.try_emplace(std::string(moduleName),
+                                 std::make_shared<ModuleGramIndex>())
+             .second) {
+      return;
+    }
+  }
+  const auto moduleMap = syncModuleCaches();
+  if (const auto module = getCachedModuleInfo(*moduleMap, moduleName)) {
+    getGramIndex(moduleName, module);
+  }
+}
+
+void setSignatureCacheDirectory(std::string_view directory) {
+  std::lock_guard lock(persistentCacheMutex);
+  persistentCacheDirectory = std::filesystem::path(directory);
+  persistentCaches.clear();
+}
+
+std::unordered_map<std::string, uintptr_t>
+resolveSignaturesInFile(std::span<const std::string> signatures,
+                        std::string_view path,
+                        const SignatureScanOptions &options) {
+  const std::string moduleName =
+      std::filesystem::path(path).filename().string();
+  ResolveStats recorder(moduleName);
+  std::unordered_map<std::string, uintptr_t> results;
+  std::vector<PendingSignature> pending;
+  for (const auto &signature : signatures) {
+    if (results.try_emplace(signature, 0).second) {
+      pending.push_back(PendingSignature{signature, pending.size()});
+    }
+  }
+  std::vector<uintptr_t> addresses(pending.size(), 0);
+  recorder.count(addresses);
+  if (results.empty()) return results;
+
+  const MappedModuleFile file{std::string(path)};
+  ModuleInfo module;
+  if (!file.valid() || !getModuleInfo(file.image(), module)) {
+    preloaderLogger.warn("failed to map module file {}", path);
+    return results;
+  }
+
+  std::vector<MemoryRegion> regions;
+  if (options.scope == SignatureScope::Section) {
+    size_t size = 0;
+    const uintptr_t start = file.findSection(options.section, size);
+    if (start != 0) regions = clipRegions(module.regions, start, start + size);
+  } else {
+    regions = getScanRegions(module, moduleName, options);
+  }
+
+  std::vector<PendingSignature> symbols;
+  std::vector<PendingSignature> patterns;
+  classifySignatures(pending, symbols, patterns);
+  resolveSymbols(&file.image(), nullptr, symbols, addresses, patterns,
+                 recorder.stats);
+  auto compiled = compilePatterns(patterns);
+  const auto derived = collectDerivedPatterns(compiled);
+  findPatternMatches(moduleName, module, regions, makeScopeTag(options),
+                     getScanAlignment(options), nullptr, compiled, addresses,
+                     recorder.stats);
+
+  // The loaded module only has to verify these, without the cache directory.
+  {
+    std::lock_guard lock(persistentCacheMutex);
+    auto &hints = offsetHints[moduleName];
+    for (const auto &entry : compiled) {
+      const uintptr_t address = addresses[entry.slot];
+      if (address != 0) {
+        hints.insert_or_assign(std::string(entry.signature),
+                               address - module.base);
+      }
+    }
+  }
+
+  for (const auto &[slot, derive] : derived) {
+    const bool relocated = std::ranges::any_of(derive, [](const auto &op) {
+      return op.kind == SignatureOpKind::Dereference;
+    });
+    addresses[slot] =
+        relocated ? 0 : deriveAddress(module.regions, addresses[slot], derive);
+  }
   for (const auto &signature : pending) {
-    sigCache[makeSignatureCacheKey(moduleName, signature)] = results[signature];
+    const uintptr_t address = addresses[signature.slot];
+    results[std::string(signature.text)] =
+        address >= module.base ? address - module.base : 0;
   }
+  recorder.count(addresses);
   return results;
 }
 
+SignatureStats getSignatureStats() {
+  SignatureStats stats;
+  for (size_t i = 0; i < totalStats.size(); ++i) {
+    stats.*kStatsFields[i] = totalStats[i].load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+void resetSignatureStats() {
+  for (auto &total : totalStats) total.store(0, std::memory_order_relaxed);
+}
+
+void setSignatureStatsLogging(bool enabled) {
+  statsLogging.store(enabled, std::memory_order_relaxed);
+}
+
+void setSignatureOffsetHint(std::string_view moduleName,
+                            std::string_view signature, uintptr_t offset) {
+  std::lock_guard lock(persistentCacheMutex);
+  offsetHints[std::string(moduleName)][std::string(signature)] = offset;
+}
+
 uintptr_t resolveSignature(std::string_view signature,
                            std::string_view moduleName) {
-  std::vector<std::string> signatures{std::string(signature)};
-  const auto results = resolveSignatures(signatures, moduleName);
-  const auto it = results.find(std::string(signature));
-  return it == results.end() ? 0 : it->second;
+  return resolveSignature(signature, moduleName, SignatureScanOptions{});
+}
+
+uintptr_t resolveSignature(std::string_view signature,
+                           std::string_view moduleName,
+                           const SignatureScanOptions &options) {
+  syncRecentModuleCaches();
+  if (const auto table =
+          getAddressTable(moduleName, makeScopeTag(options))) {
+    const auto it = table->find(signature);
+    if (it != table->end()) return it->second;
+  }
+
+  uintptr_t address = 0;
+  resolveSignatures(std::span(&signature, 1), moduleName,
+                    std::span(&address, 1), options);
+  return address;
+}
+
+uintptr_t resolveSignature(const PrecompiledSignature &signature,
+                           std::string_view moduleName,
+                           const SignatureScanOptions &options) {
+  syncRecentModuleCaches();
+  if (const auto table =
+          getAddressTable(moduleName, makeScopeTag(options))) {
+    const auto it = table->find(signature.text);
+    if (it != table->end()) return it->second;
+  }
+
+  uintptr_t address = 0;
+  resolveSignatures(std::span(&signature, 1), moduleName,
+                    std::span(&address, 1), options);
+  return address;
+}
+
+std::vector<uintptr_t>
+resolveSignatures(std::span<const PrecompiledSignature> signatures,
+                  std::string_view moduleName,
+                  const SignatureScanOptions &options) {
+  std::vector<uintptr_t> addresses(signatures.size(), 0);
+  resolveSignatures(signatures, moduleName, addresses, options);
+  return addresses;
 }
 
 }
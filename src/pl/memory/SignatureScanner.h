@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace pl::memory {
+
+// Matchers a scan can run on. Scans pick the cheapest one that can hold the
+// batch; the automaton is the reference every other engine must agree with.
+enum class ScanEngine {
+  Prefilter, // SIMD search for up to eight anchor byte pairs.
+  Bucketed,  // Nibble tables over four-byte fingerprints, eight buckets.
+  Hashed,    // Masked 8-byte windows hashed into a bitmap.
+  ShiftAnd,  // Bit-parallel exact anchors, up to 64 bytes in total.
+  Compact,   // Aho-Corasick over the byte classes anchors use.
+  Automaton, // Aho-Corasick over all 256 byte values.
+};
+
+// Scans one block of memory for every signature without consulting or filling
+// the address caches. Addresses are in the order of signatures, 0 when a
+// signature is not found or is malformed; alignment is as in
+// SignatureScanOptions.
+std::vector<uintptr_t>
+scanSignatureBuffer(std::span<const std::string> signatures,
+                    std::span<const uint8_t> memory, size_t alignment = 1);
+
+// As above on engine only, for comparing engines on the same input. Empty
+// when engine cannot hold the batch; an empty memory only builds it.
+std::optional<std::vector<uintptr_t>>
+scanSignatureBuffer(std::span<const std::string> signatures,
+                    std::span<const uint8_t> memory, ScanEngine engine,
+                    size_t alignment = 1);
+
+// Drops every in-memory signature cache, so the next resolve parses and scans
+// from scratch. Offsets persisted on disk are kept.
+void clearSignatureCaches();
+
+} // namespace pl::memory
@@ -0,0 +1,247 @@
+#include "pl/memory/SuffixIndex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+namespace pl::memory {
+namespace {
+
+constexpr char kIndexMagic[8] = {'p', 'l', 's', 'f', 'x', '2', 0, 0};
+
+struct IndexHeader {
+  char magic[8] = {};
+  uint32_t alignment = 0;
+  uint32_t depth = 0;
+  uint64_t rangeCount = 0;
+  uint64_t positionCount = 0;
+};
+
+uintptr_t alignUp(uintptr_t address, size_t alignment) {
+  return (address + alignment - 1) & ~(uintptr_t{alignment} - 1);
+}
+
+// Runs task(0) .. task(count - 1) on up to workerCount threads.
+void runParallel(size_t count, size_t workerCount,
+                 const std::function<void(size_t)> &task) {
+  std::atomic<size_t> next{0};
+  auto worker = [&] {
+    for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+      task(i);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(count, workerCount); ++i) {
+    try {
+      threads.emplace_back(worker);
+    } catch (const std::system_error &) {
+      break;
+    }
+  }
+  worker();
+  for (auto &thread : threads) thread.join();
+}
+
+} // namespace
+
+SuffixIndex::SuffixIndex(uintptr_t base, std::vector<IndexedRange> ranges,
+                         size_t alignment)
+    : mBase(base), mRanges(std::move(ranges)),
+      mAlignment(std::max<size_t>(alignment, 1)) {}
+
+const IndexedRange *SuffixIndex::findRange(uintptr_t address) const {
+  for (const auto &range : mRanges) {
+    if (address >= range.start && address < range.end) return &range;
+  }
+  return nullptr;
+}
+
+size_t SuffixIndex::suffixSize(uintptr_t address,
+                               const IndexedRange &range) const {
+  return std::min<size_t>(range.end - address, kDepth);
+}
+
+size_t SuffixIndex::countPositions() const {
+  size_t count = 0;
+  for (const auto &range : mRanges) {
+    const uintptr_t first = alignUp(range.start, mAlignment);
+    if (first < range.end) count += (range.end - first - 1) / mAlignment + 1;
+  }
+  return count;
+}
+
+bool SuffixIndex::build(size_t workerCount) {
+  mOffsets.clear();
+  for (const auto &range : mRanges) {
+    if (range.start < mBase || range.end < range.start ||
+        range.end - mBase > UINT32_MAX) {
+      return false;
+    }
+  }
+
+  struct Part {
+    size_t begin = 0;
+    size_t end = 0;
+    const IndexedRange *range = nullptr;
+  };
+  std::vector<Part> parts;
+  mOffsets.reserve(countPositions());
+  workerCount = std::max<size_t>(workerCount, 1);
+  for (const auto &range : mRanges) {
+    const size_t begin = mOffsets.size();
+    for (uintptr_t address = alignUp(range.start, mAlignment);
+         address < range.end; address += mAlignment) {
+      mOffsets.push_back(static_cast<uint32_t>(address - mBase));
+    }
+    const size_t partSize =
+        (mOffsets.size() - begin + workerCount - 1) / workerCount;
+    for (size_t start = begin; start < mOffsets.size(); start += partSize) {
+      parts.push_back(
+          Part{start, std::min(start + partSize, mOffsets.size()), &range});
+    }
+  }
+
+  // Parts of one range sort without looking ranges up; merging them is the
+  // only step that compares positions of different ranges.
+  runParallel(parts.size(), workerCount, [&](size_t index) {
+    const auto &part = parts[index];
+    const auto &range = *part.range;
+    std::sort(mOffsets.begin() + part.begin, mOffsets.begin() + part.end,
+              [&](uint32_t left, uint32_t right) {
+                const uintptr_t a = mBase + left;
+                const uintptr_t b = mBase + right;
+                const size_t sizeA = suffixSize(a, range);
+                const size_t sizeB = suffixSize(b, range);
+                const int order =
+                    std::memcmp(reinterpret_cast<const void *>(a),
+                                reinterpret_cast<const void *>(b),
+                                std::min(sizeA, sizeB));
+                if (order != 0) return order < 0;
+                return sizeA != sizeB ? sizeA < sizeB : left < right;
+              });
+  });
+
+  const auto less = [this](uint32_t left, uint32_t right) {
+    const uintptr_t a = mBase + left;
+    const uintptr_t b = mBase + right;
+    const size_t sizeA = suffixSize(a, *findRange(a));
+    const size_t sizeB = suffixSize(b, *findRange(b));
+    const int order = std::memcmp(reinterpret_cast<const void *>(a),
+                                  reinterpret_cast<const void *>(b),
+                                  std::min(sizeA, sizeB));
+    if (order != 0) return order < 0;
+    return sizeA != sizeB ? sizeA < sizeB : left < right;
+  };
+  while (parts.size() > 1) {
+    std::vector<Part> merged((parts.size() + 1) / 2);
+    runParallel(merged.size(), workerCount, [&](size_t index) {
+      const auto &first = parts[index * 2];
+      if (index * 2 + 1 == parts.size()) {
+        merged[index] = first;
+        return;
+      }
+      const auto &second = parts[index * 2 + 1];
+      std::inplace_merge(mOffsets.begin() + first.begin,
+                         mOffsets.begin() + second.begin,
+                         mOffsets.begin() + second.end, less);
+      merged[index] = Part{first.begin, second.end, nullptr};
+    });
+    parts = std::move(merged);
+  }
+  return true;
+}
+
+bool SuffixIndex::load(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  IndexHeader header;
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+      header.alignment != mAlignment || header.depth != kDepth ||
+      header.rangeCount != mRanges.size() ||
+      header.positionCount != countPositions()) {
+    return false;
+  }
+  for (const auto &range : mRanges) {
+    uint64_t bounds[2] = {};
+    if (!file.read(reinterpret_cast<char *>(bounds), sizeof(bounds)) ||
+        bounds[0] != range.start - mBase || bounds[1] != range.end - mBase) {
+      return false;
+    }
+  }
+
+  std::vector<uint32_t> offsets(header.positionCount);
+  if (!file.read(reinterpret_cast<char *>(offsets.data()),
+                 static_cast<std::streamsize>(offsets.size() *
+                                              sizeof(uint32_t)))) {
+    return false;
+  }
+  // find() reads memory at every offset, so a damaged file must not get in.
+  for (const uint32_t offset : offsets) {
+    const uintptr_t address = mBase + offset;
+    if ((address & (mAlignment - 1)) != 0 || !findRange(address)) {
+      return false;
+    }
+  }
+  mOffsets = std::move(offsets);
+  return true;
+}
+
+bool SuffixIndex::save(const std::filesystem::path &path) const {
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+
+  auto tempPath = path;
+  tempPath += ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    IndexHeader header;
+    std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    header.alignment = static_cast<uint32_t>(mAlignment);
+    header.depth = kDepth;
+    header.rangeCount = mRanges.size();
+    header.positionCount = mOffsets.size();
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto &range : mRanges) {
+      const uint64_t bounds[2] = {range.start - mBase, range.end - mBase};
+      file.write(reinterpret_cast<const char *>(bounds), sizeof(bounds));
+    }
+    file.write(reinterpret_cast<const char *>(mOffsets.data()),
+               static_cast<std::streamsize>(mOffsets.size() *
+                                            sizeof(uint32_t)));
+    if (!file) return false;
+  }
+  std::filesystem::rename(tempPath, path, error);
+  return !error;
+}
+
+std::span<const uint32_t>
+SuffixIndex::find(std::span<const uint8_t> key) const {
+  key = key.first(std::min(key.size(), kDepth));
+  // Negative when the position sorts before every string starting with key,
+  // zero when it starts with key.
+  const auto compare = [&](uint32_t offset) {
+    const uintptr_t address = mBase + offset;
+    const size_t size = suffixSize(address, *findRange(address));
+    const int order =
+        std::memcmp(reinterpret_cast<const void *>(address), key.data(),
+                    std::min(size, key.size()));
+    if (order != 0) return order;
+    return size < key.size() ? -1 : 0;
+  };
+  const auto begin = std::partition_point(
+      mOffsets.begin(), mOffsets.end(),
+      [&](uint32_t offset) { return compare(offset) < 0; });
+  const auto end = std::partition_point(
+      begin, mOffsets.end(),
+      [&](uint32_t offset) { return compare(offset) == 0; });
+  return {begin, end};
+}
+
+} // namespace pl::memory
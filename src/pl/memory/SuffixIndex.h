@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace pl::memory {
+
+// Memory a suffix index covers; no indexed string crosses its end.
+struct IndexedRange {
+  uintptr_t start = 0;
+  uintptr_t end = 0;
+};
+
+// Every aligned position of some ranges, sorted by the first kDepth bytes that
+// follow it, so all occurrences of an exact byte string of up to kDepth bytes
+// are one binary search away. Positions are kept as 32-bit offsets from the
+// base, which is also how they are saved, so a saved index fits any mapping
+// of the same file.
+class SuffixIndex {
+public:
+  static constexpr size_t kDepth = 64;
+
+  SuffixIndex(uintptr_t base, std::vector<IndexedRange> ranges,
+              size_t alignment);
+
+  // Sorts the positions on up to workerCount threads. Fails when a range ends
+  // too far from the base for 32-bit offsets.
+  bool build(size_t workerCount);
+
+  // Takes the positions saved for the same ranges and alignment, or returns
+  // false when the file is missing or was saved for something else.
+  bool load(const std::filesystem::path &path);
+  bool save(const std::filesystem::path &path) const;
+
+  // Offsets from the base of every position whose bytes start with key; key is
+  // cut to kDepth bytes.
+  [[nodiscard]] std::span<const uint32_t>
+  find(std::span<const uint8_t> key) const;
+
+  // Range containing address, or nullptr.
+  [[nodiscard]] const IndexedRange *findRange(uintptr_t address) const;
+
+  [[nodiscard]] uintptr_t base() const noexcept { return mBase; }
+  [[nodiscard]] size_t alignment() const noexcept { return mAlignment; }
+  [[nodiscard]] size_t size() const noexcept { return mOffsets.size(); }
+
+private:
+  // Bytes that follow address inside its range, at most kDepth.
+  [[nodiscard]] size_t suffixSize(uintptr_t address,
+                                  const IndexedRange &range) const;
+  [[nodiscard]] size_t countPositions() const;
+
+  uintptr_t mBase;
+  std::vector<IndexedRange> mRanges;
+  size_t mAlignment;
+  std::vector<uint32_t> mOffsets;
+};
+
+} // namespace pl::memory
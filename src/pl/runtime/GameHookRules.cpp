@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cstdint>
 #include <fstream>
 #include <iterator>
 #include <limits>
@@ -62,6 +64,44 @@ std::optional<std::string> ReadStringField(const nlohmann::json &object,
   return value;
 }
 
+// Accepts a number, a hexadecimal string such as "0x8a1c40" or a decimal
+// string. Hex digits need the 0x prefix, so "1000" is never read as 0x1000.
+std::optional<uintptr_t> ReadOffsetField(const nlohmann::json &object,
+                                         const char *key) {
+  if (!object.is_object()) {
+    return std::nullopt;
+  }
+
+  auto it = object.find(key);
+  if (it == object.end()) {
+    return std::nullopt;
+  }
+  if (it->is_number_unsigned()) {
+    return it->get<uintptr_t>();
+  }
+
+  auto text = ReadStringField(object, key);
+  if (!text) {
+    return std::nullopt;
+  }
+
+  std::string_view digits = *text;
+  int base = 10;
+  if (digits.size() > 2 && digits[0] == '0' &&
+      (digits[1] == 'x' || digits[1] == 'X')) {
+    digits.remove_prefix(2);
+    base = 16;
+  }
+  uintptr_t offset = 0;
+  const auto [end, error] = std::from_chars(
+      digits.data(), digits.data() + digits.size(), offset, base);
+  if (error != std::errc() || end != digits.data() + digits.size()) {
+    preloaderLogger.warn("Ignoring invalid Preloader offset hint {}", key);
+    return std::nullopt;
+  }
+  return offset;
+}
+
 std::vector<int> ParseVersionParts(std::string_view value) {
   std::vector<int> parts;
   long current = 0;
@@ -145,13 +185,28 @@ std::optional<GameHookSignatures> ParseHookSignatures(const nlohmann::json &rule
     return std::nullopt;
   }
 
-  return GameHookSignatures{
+  GameHookSignatures signatures{
       *pauseMenuDtor,
       *pauseMenuOpen,
       *hudScreenDtor,
       *hudScreenOpen,
       *isShowingMenu,
+      {},
+  };
+
+  const std::pair<const char *, const std::string *> offsetFields[] = {
+      {"pauseMenuDtorOffset", &signatures.pauseMenuDtor},
+      {"pauseMenuOpenOffset", &signatures.pauseMenuOpen},
+      {"hudScreenDtorOffset", &signatures.hudScreenDtor},
+      {"hudScreenOpenOffset", &signatures.hudScreenOpen},
+      {"isShowingMenuOffset", &signatures.isShowingMenu},
   };
+  for (const auto &[key, signature] : offsetFields) {
+    if (auto offset = ReadOffsetField(*sigs, key)) {
+      signatures.offsetHints.emplace_back(*signature, *offset);
+    }
+  }
+  return signatures;
 }
 
 } // namespace
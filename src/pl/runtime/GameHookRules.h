@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace pl::runtime {
 
@@ -11,6 +14,8 @@ struct GameHookSignatures {
   std::string hudScreenDtor;
   std::string hudScreenOpen;
   std::string isShowingMenu;
+  // Optional "<name>Offset" fields: signature and expected module offset.
+  std::vector<std::pair<std::string, uintptr_t>> offsetHints;
 };
 
 void ConfigureGameHookRules(std::string rulesPath, std::string minecraftVersion);
@@ -1,10 +1,11 @@
 #include "pl/runtime/GameHooks.h"
 
+#include <array>
 #include <atomic>
 #include <cstdint>
 #include <mutex>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -21,6 +22,10 @@ std::atomic_bool g_isHudScreenOpen{false};
 std::atomic_bool g_isShowingMenu{false};
 std::atomic_bool g_forceGlobalModMenu{true};
 std::once_flag g_gameHooksOnce;
+std::mutex g_signaturePrefetchMutex;
+pl::memory::SignatureFuture g_signaturePrefetch;
+
+constexpr const char *kGameModuleName = "libminecraftpe.so";
 
 void (*orig_PauseMenuDtor)(void *) = nullptr;
 void hook_PauseMenuDtor(void *_this) {
@@ -64,11 +69,51 @@ bool hook_isShowingMenu(void *_this) {
   return res;
 }
 
-uintptr_t ResolveResult(
-    const std::unordered_map<std::string, uintptr_t> &results,
-    const std::string &signature) {
-  auto it = results.find(signature);
-  return it == results.end() ? 0 : it->second;
+std::array<std::string_view, 5>
+RequestedSignatures(const GameHookSignatures &signatures) {
+  return {signatures.pauseMenuDtor, signatures.pauseMenuOpen,
+          signatures.hudScreenDtor, signatures.hudScreenOpen,
+          signatures.isShowingMenu};
+}
+
+// Lets a resolve after a game update start near where the rules expect each
+// target instead of scanning the whole module.
+void ApplyOffsetHints(const GameHookSignatures &signatures) {
+  for (const auto &[signature, offset] : signatures.offsetHints) {
+    pl::memory::setSignatureOffsetHint(kGameModuleName, signature, offset);
+  }
+}
+
+pl::memory::SignatureScanOptions GameHookScanOptions() {
+  pl::memory::SignatureScanOptions options;
+  options.scope = pl::memory::SignatureScope::Executable;
+  options.alignment = pl::memory::kCodeAlignment;
+  return options;
+}
+
+// Starts scanning for the configured hook targets while mods are still
+// loading; InitGameHooks later picks the results up from the signature cache.
+void PrefetchGameHookSignatures() {
+  auto signatures = LoadConfiguredGameHookSignatures();
+  if (!signatures) {
+    return;
+  }
+
+  ApplyOffsetHints(*signatures);
+  std::lock_guard lock(g_signaturePrefetchMutex);
+  const auto requested = RequestedSignatures(*signatures);
+  g_signaturePrefetch = pl::memory::resolveSignaturesAsync(
+      {requested.begin(), requested.end()}, kGameModuleName,
+      GameHookScanOptions());
+}
+
+void WaitForSignaturePrefetch() {
+  pl::memory::SignatureFuture prefetch;
+  {
+    std::lock_guard lock(g_signaturePrefetchMutex);
+    prefetch = std::move(g_signaturePrefetch);
+  }
+  prefetch.wait();
 }
 
 bool InstallHook(uintptr_t target, pl::memory::FuncPtr detour,
@@ -92,6 +137,7 @@ bool InstallHook(uintptr_t target, pl::memory::FuncPtr detour,
 void ConfigureGameHooks(std::string rulesPath, std::string minecraftVersion) {
   ConfigureGameHookRules(std::move(rulesPath), std::move(minecraftVersion));
   g_forceGlobalModMenu.store(true, std::memory_order_relaxed);
+  PrefetchGameHookSignatures();
 }
 
 void InitGameHooks() {
@@ -102,19 +148,15 @@ void InitGameHooks() {
       return;
     }
 
-    const std::vector<std::string> requestedSignatures{
-        signatures->pauseMenuDtor, signatures->pauseMenuOpen,
-        signatures->hudScreenDtor, signatures->hudScreenOpen,
-        signatures->isShowingMenu};
-    auto results = pl::memory::resolveSignatures(
-        requestedSignatures, "libminecraftpe.so");
-
-    uintptr_t pauseDtor = ResolveResult(results, signatures->pauseMenuDtor);
-    uintptr_t pauseOpen = ResolveResult(results, signatures->pauseMenuOpen);
-    uintptr_t hudDtor = ResolveResult(results, signatures->hudScreenDtor);
-    uintptr_t hudOpen = ResolveResult(results, signatures->hudScreenOpen);
-    uintptr_t isShowingMenuAddr =
-        ResolveResult(results, signatures->isShowingMenu);
+    WaitForSignaturePrefetch();
+    ApplyOffsetHints(*signatures);
+    const auto requestedSignatures = RequestedSignatures(*signatures);
+    std::array<uintptr_t, requestedSignatures.size()> addresses{};
+    pl::memory::resolveSignatures(requestedSignatures, kGameModuleName,
+                                  addresses, GameHookScanOptions());
+
+    const auto [pauseDtor, pauseOpen, hudDtor, hudOpen, isShowingMenuAddr] =
+        addresses;
 
     bool hooksReady = true;
     hooksReady &= InstallHook(pauseDtor,